@@ -0,0 +1,73 @@
+#include "AnalysisCache.h"
+
+namespace myproject {
+
+// LiveVariables needs every statement in the CFG, and the other checks work fine on top of it
+static void setCFGBuildOptions(clang::CFG::BuildOptions& options) {
+    options.setAllAlwaysAdd();
+}
+
+std::shared_ptr<clang::AnalysisDeclContext> AnalysisCache::buildContext(const clang::FunctionDecl* FD) {
+    if (!FD || !FD->hasBody()) return nullptr;
+
+    clang::CFG::BuildOptions options;
+    setCFGBuildOptions(options);
+    auto context = std::make_shared<clang::AnalysisDeclContext>(nullptr, FD, options);
+    context->getCFG();
+    return context;
+}
+
+clang::AnalysisDeclContext* AnalysisCache::getContext(const clang::FunctionDecl* FD, clang::ASTContext& Context) {
+    if (!FD || !FD->hasBody()) return nullptr;
+
+    if (prebuilt) {
+        return prebuilt->getDecl()->getCanonicalDecl() == FD->getCanonicalDecl() ? prebuilt.get() : nullptr;
+    }
+
+    // A new TU needs a manager bound to its own ASTContext
+    if (!manager || astContext != &Context) {
+        manager = std::make_unique<clang::AnalysisDeclContextManager>(Context);
+        setCFGBuildOptions(manager->getCFGBuildOptions());
+        astContext = &Context;
+        current = nullptr;
+    }
+
+    const clang::Decl* canonical = FD->getCanonicalDecl();
+    if (current != canonical) {
+        release();
+        current = canonical;
+        // Every check asks for the CFG right away, build it here so its cost can be told apart from the checks
+        Stopwatch watch;
+        manager->getContext(FD)->getCFG();
+        cfgTime.add(watch.seconds());
+    }
+    return manager->getContext(FD);
+}
+
+const clang::CFG* AnalysisCache::getCFG(const clang::FunctionDecl* FD, clang::ASTContext& Context) {
+    clang::AnalysisDeclContext* AC = getContext(FD, Context);
+    return AC ? AC->getCFG() : nullptr;
+}
+
+const clang::CFG* AnalysisCache::getCachedCFG(const clang::FunctionDecl* FD) const {
+    if (!FD) return nullptr;
+    if (prebuilt) {
+        return prebuilt->getDecl()->getCanonicalDecl() == FD->getCanonicalDecl() ? prebuilt->getCFG() : nullptr;
+    }
+    if (!manager || current != FD->getCanonicalDecl()) return nullptr;
+    return manager->getContext(FD)->getCFG();
+}
+
+void AnalysisCache::release() {
+    if (manager) manager->clear();
+    current = nullptr;
+}
+
+void AnalysisCache::clear() {
+    manager.reset();
+    cfgTime = {};
+    astContext = nullptr;
+    current = nullptr;
+}
+
+} // namespace myproject
@@ -0,0 +1,59 @@
+#ifndef ANALYSIS_CACHE_H
+#define ANALYSIS_CACHE_H
+
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/Decl.h>
+#include <clang/Analysis/AnalysisDeclContext.h>
+#include <clang/Analysis/CFG.h>
+#include <memory>
+#include "TimeReport.h"
+
+namespace myproject {
+
+// Per-TU cache of the function-level analyses used by the checks (CFG, ParentMap, LiveVariables, ...).
+// Every check asking for the same function gets the same AnalysisDeclContext, so the CFG and the
+// derived analyses are built only once no matter how many checks are enabled.
+//
+// MatchFinder reports all matches of a node back to back, so only the function that is currently
+// being analyzed is kept: asking for another function frees everything built for the previous one.
+class AnalysisCache {
+public:
+    AnalysisCache() = default;
+
+    // A cache that only serves one context built up front with buildContext(), used by the parallel
+    // function mode where nothing may touch the shared ASTContext from worker threads
+    explicit AnalysisCache(std::shared_ptr<clang::AnalysisDeclContext> prebuilt) : prebuilt(std::move(prebuilt)) {}
+
+    // Build a standalone context for FD with the same CFG options as the cache, and build its CFG.
+    // CFG construction evaluates constants and fills ASTContext caches, so call this on the thread that owns the AST.
+    static std::shared_ptr<clang::AnalysisDeclContext> buildContext(const clang::FunctionDecl* FD);
+
+    // Return the shared context of FD, or nullptr if FD has no body
+    clang::AnalysisDeclContext* getContext(const clang::FunctionDecl* FD, clang::ASTContext& Context);
+
+    // Shortcut for getContext(FD, Context)->getCFG()
+    const clang::CFG* getCFG(const clang::FunctionDecl* FD, clang::ASTContext& Context);
+
+    // The CFG of FD if it is the function currently cached, never builds anything
+    const clang::CFG* getCachedCFG(const clang::FunctionDecl* FD) const;
+
+    // Time spent building CFGs in getContext() since the last clear()
+    const TimeStat& getCFGTime() const { return cfgTime; }
+
+    // Free the analyses of the current function
+    void release();
+
+    // Free everything, called at the end of each translation unit
+    void clear();
+
+private:
+    std::shared_ptr<clang::AnalysisDeclContext> prebuilt;
+    std::unique_ptr<clang::AnalysisDeclContextManager> manager;
+    clang::ASTContext* astContext = nullptr;
+    const clang::Decl* current = nullptr;
+    TimeStat cfgTime;
+};
+
+} // namespace myproject
+
+#endif // ANALYSIS_CACHE_H
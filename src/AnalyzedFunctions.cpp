@@ -0,0 +1,35 @@
+#include "AnalyzedFunctions.h"
+#include <clang/AST/ODRHash.h>
+#include <clang/Index/USRGeneration.h>
+#include <llvm/ADT/SmallString.h>
+#include <format>
+
+namespace myproject {
+
+std::optional<std::string> AnalyzedFunctions::key(const clang::FunctionDecl* FD) {
+    llvm::SmallString<128> usr;
+    if (clang::index::generateUSRForDecl(FD, usr)) return std::nullopt; // true means no USR
+
+    // The ODR hash covers the signature and the body statement by statement, names instead of pointers,
+    // so it is the same in every TU that sees the same definition
+    clang::ODRHash hash;
+    hash.AddFunctionDecl(FD);
+    return std::format("{}#{:08x}", usr.str().str(), hash.CalculateHash());
+}
+
+bool AnalyzedFunctions::claim(llvm::StringRef key) {
+    bool inserted;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inserted = keys.insert(key).second;
+    }
+    (inserted ? claimed : skipped).fetch_add(1, std::memory_order_relaxed);
+    return inserted;
+}
+
+bool AnalyzedFunctions::isClaimed(llvm::StringRef key) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return keys.contains(key);
+}
+
+} // namespace myproject
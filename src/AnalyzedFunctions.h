@@ -0,0 +1,41 @@
+#ifndef ANALYZED_FUNCTIONS_H
+#define ANALYZED_FUNCTIONS_H
+
+#include <clang/AST/Decl.h>
+#include <llvm/ADT/StringSet.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace myproject {
+
+// Functions of headers analyzed so far in this run, shared by every worker. An inline function of a
+// header is parsed again in every TU including it; the first TU to claim it analyzes it and reports
+// its findings, the others skip it. All TUs run the same checks, so one claim covers all of them.
+class AnalyzedFunctions {
+public:
+    // Identifies a definition across TUs: its USR plus an ODR hash of the definition, so a function
+    // whose body differs between TUs (macros, ODR violations) is analyzed once per distinct body.
+    // std::nullopt when the function has no USR.
+    static std::optional<std::string> key(const clang::FunctionDecl* FD);
+
+    // True for the first caller with this key, thread-safe
+    bool claim(llvm::StringRef key);
+    // True once some caller claimed `key`, thread-safe
+    bool isClaimed(llvm::StringRef key) const;
+
+    uint64_t getClaimed() const { return claimed.load(std::memory_order_relaxed); }
+    uint64_t getSkipped() const { return skipped.load(std::memory_order_relaxed); }
+
+private:
+    mutable std::mutex mutex;
+    llvm::StringSet<> keys;
+    std::atomic<uint64_t> claimed{0};
+    std::atomic<uint64_t> skipped{0};
+};
+
+} // namespace myproject
+
+#endif // ANALYZED_FUNCTIONS_H
@@ -0,0 +1,50 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <llvm/Support/Allocator.h>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace myproject {
+
+// Bump allocator for the temporaries of one check() call. MyMatchCallback resets it as soon as check()
+// returns, so nothing allocated from it may be kept. Reset() keeps the first 64 KiB slab, most functions
+// never need a second one and cost no heap allocation at all.
+using Arena = llvm::BumpPtrAllocatorImpl<llvm::MallocAllocator, 64 * 1024>;
+
+// Standard allocator on top of an Arena, for containers of check temporaries. Without an arena it uses the
+// heap. Memory given back to the arena is only reused after the reset.
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator(Arena* arena = nullptr) noexcept : arena(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.getArena()) {}
+
+    T* allocate(size_t n) {
+        if (arena) return static_cast<T*>(arena->Allocate(n * sizeof(T), alignof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t) noexcept {
+        if (!arena) ::operator delete(p);
+    }
+
+    Arena* getArena() const noexcept { return arena; }
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept { return arena == other.getArena(); }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept { return arena != other.getArena(); }
+
+private:
+    Arena* arena;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+} // namespace myproject
+
+#endif // ARENA_H
@@ -0,0 +1,292 @@
+#include "BitVectorLiveness.h"
+#include <clang/AST/DeclCXX.h>
+#include <clang/AST/Expr.h>
+#include <clang/AST/StmtObjC.h>
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseSet.h>
+#include <algorithm>
+
+namespace myproject {
+
+namespace {
+
+// Same as the isAlwaysAlive() of LiveVariables: globals are never tracked
+bool isAlwaysAlive(const clang::VarDecl* VD) {
+    return VD->hasGlobalStorage();
+}
+
+bool writeShouldKill(const clang::VarDecl* VD) {
+    return !VD->getType()->isReferenceType() && !isAlwaysAlive(VD);
+}
+
+} // namespace
+
+const void* BitVectorLiveness::getTag() {
+    static int tag;
+    return &tag;
+}
+
+std::unique_ptr<BitVectorLiveness> BitVectorLiveness::create(clang::AnalysisDeclContext& AC) {
+    Deadline never;
+    return create(AC, never);
+}
+
+std::unique_ptr<BitVectorLiveness> BitVectorLiveness::create(clang::AnalysisDeclContext& AC, Deadline& deadline) {
+    const clang::CFG* cfg = AC.getCFG();
+    if (!cfg) return nullptr;
+
+    std::unique_ptr<BitVectorLiveness> liveness(new BitVectorLiveness(*cfg));
+    liveness->buildSteps(AC);
+    if (!liveness->solve(deadline)) return nullptr;
+    return liveness;
+}
+
+unsigned BitVectorLiveness::getId(const clang::Decl* D) {
+    auto [it, inserted] = ids.try_emplace(D, static_cast<unsigned>(decls.size()));
+    if (inserted) decls.push_back(D);
+    return it->second;
+}
+
+// Lower every CFG element to its list of gens and kills, in the order runOnBlock() of LiveVariables applies them:
+// the terminator first, then the elements from the last to the first.
+void BitVectorLiveness::buildSteps(clang::AnalysisDeclContext& AC) {
+    // Plain assignments do not read their left hand side
+    llvm::DenseSet<const clang::DeclRefExpr*> inAssignment;
+    for (const clang::CFGBlock* block : cfg) {
+        for (const clang::CFGElement& element : *block) {
+            auto stmt = element.getAs<clang::CFGStmt>();
+            if (!stmt) continue;
+            if (const auto* BO = llvm::dyn_cast<clang::BinaryOperator>(stmt->getStmt())) {
+                if (BO->getOpcode() != clang::BO_Assign) continue;
+                if (const auto* DR = llvm::dyn_cast<clang::DeclRefExpr>(BO->getLHS()->IgnoreParens()))
+                    inAssignment.insert(DR);
+            }
+        }
+    }
+
+    auto gen = [this](const clang::Decl* D) { ops.push_back({getId(D), 0}); };
+    auto kill = [this](const clang::Decl* D) { ops.push_back({getId(D), 1}); };
+
+    auto lower = [&](const clang::Stmt* S) {
+        Step step{S, static_cast<uint32_t>(ops.size()), 0};
+
+        if (const auto* BO = llvm::dyn_cast<clang::BinaryOperator>(S)) {
+            if (BO->isAssignmentOp()) {
+                if (const auto* DR = llvm::dyn_cast<clang::DeclRefExpr>(BO->getLHS()->IgnoreParens())) {
+                    if (const auto* BD = llvm::dyn_cast<clang::BindingDecl>(DR->getDecl())) {
+                        if (!BD->getType()->isReferenceType()) {
+                            if (const auto* HV = BD->getHoldingVar()) kill(HV);
+                            kill(BD);
+                        }
+                    } else if (const auto* VD = llvm::dyn_cast<clang::VarDecl>(DR->getDecl())) {
+                        if (writeShouldKill(VD)) kill(VD);
+                    }
+                }
+            }
+        } else if (const auto* DR = llvm::dyn_cast<clang::DeclRefExpr>(S)) {
+            bool assigned = inAssignment.count(DR);
+            if (const auto* BD = llvm::dyn_cast<clang::BindingDecl>(DR->getDecl())) {
+                if (!assigned) {
+                    if (const auto* HV = BD->getHoldingVar()) gen(HV);
+                    gen(BD);
+                }
+            } else if (const auto* VD = llvm::dyn_cast<clang::VarDecl>(DR->getDecl())) {
+                if (!assigned && !isAlwaysAlive(VD)) gen(VD);
+            }
+        } else if (const auto* DS = llvm::dyn_cast<clang::DeclStmt>(S)) {
+            for (const clang::Decl* D : DS->decls()) {
+                if (const auto* DD = llvm::dyn_cast<clang::DecompositionDecl>(D)) {
+                    for (const clang::BindingDecl* BD : DD->bindings()) {
+                        if (const auto* HV = BD->getHoldingVar()) kill(HV);
+                        kill(BD);
+                    }
+                    kill(DD);
+                } else if (const auto* VD = llvm::dyn_cast<clang::VarDecl>(D)) {
+                    if (!isAlwaysAlive(VD)) kill(VD);
+                }
+            }
+        } else if (const auto* BE = llvm::dyn_cast<clang::BlockExpr>(S)) {
+            for (const clang::VarDecl* VD : AC.getReferencedBlockVars(BE->getBlockDecl())) {
+                if (!isAlwaysAlive(VD)) gen(VD);
+            }
+        } else if (const auto* OS = llvm::dyn_cast<clang::ObjCForCollectionStmt>(S)) {
+            const clang::Stmt* element = OS->getElement();
+            if (const auto* ES = llvm::dyn_cast<clang::DeclStmt>(element)) {
+                kill(ES->getSingleDecl());
+            } else if (const auto* ER = llvm::dyn_cast<clang::DeclRefExpr>(llvm::cast<clang::Expr>(element)->IgnoreParens())) {
+                kill(ER->getDecl());
+            }
+        }
+
+        step.numOps = static_cast<uint32_t>(ops.size()) - step.firstOp;
+        steps.push_back(step);
+    };
+
+    blockSteps.assign(cfg.getNumBlockIDs() + 1, 0);
+    std::vector<std::pair<uint32_t, uint32_t>> ranges(cfg.getNumBlockIDs());
+    for (const clang::CFGBlock* block : cfg) {
+        uint32_t first = static_cast<uint32_t>(steps.size());
+        if (const clang::Stmt* term = block->getTerminatorStmt()) lower(term);
+        for (auto it = block->rbegin(), end = block->rend(); it != end; ++it) {
+            if (auto dtor = it->getAs<clang::CFGAutomaticObjDtor>()) {
+                steps.push_back({nullptr, static_cast<uint32_t>(ops.size()), 1});
+                ops.push_back({getId(dtor->getVarDecl()), 0});
+                continue;
+            }
+            if (auto stmt = it->getAs<clang::CFGStmt>()) lower(stmt->getStmt());
+        }
+        ranges[block->getBlockID()] = {first, static_cast<uint32_t>(steps.size())};
+    }
+
+    // Renumber the steps so that the steps of a block are contiguous and indexed by block ID
+    std::vector<Step> ordered;
+    ordered.reserve(steps.size());
+    for (unsigned id = 0; id < ranges.size(); ++id) {
+        blockSteps[id] = static_cast<uint32_t>(ordered.size());
+        ordered.insert(ordered.end(), steps.begin() + ranges[id].first, steps.begin() + ranges[id].second);
+    }
+    blockSteps[ranges.size()] = static_cast<uint32_t>(ordered.size());
+    steps = std::move(ordered);
+
+    words = (decls.size() + 63) / 64;
+}
+
+void BitVectorLiveness::apply(const Step& step, uint64_t* bits) const {
+    for (uint32_t i = step.firstOp, end = step.firstOp + step.numOps; i < end; ++i) {
+        uint64_t mask = uint64_t(1) << (ops[i].id % 64);
+        if (ops[i].kill) bits[ops[i].id / 64] &= ~mask;
+        else bits[ops[i].id / 64] |= mask;
+    }
+}
+
+bool BitVectorLiveness::solve(Deadline& deadline) {
+    unsigned numBlocks = cfg.getNumBlockIDs();
+    liveIn.assign(size_t(numBlocks) * words, 0);
+    liveOut.assign(size_t(numBlocks) * words, 0);
+
+    // Summarize each block as liveIn = (liveOut & ~kill) | gen, so the fixpoint does not look at statements
+    std::vector<uint64_t> gens(liveIn.size(), 0), kills(liveIn.size(), 0);
+    for (unsigned id = 0; id < numBlocks; ++id) {
+        uint64_t* gen = row(gens, id);
+        uint64_t* kill = row(kills, id);
+        for (uint32_t s = blockSteps[id]; s < blockSteps[id + 1]; ++s) {
+            const Step& step = steps[s];
+            for (uint32_t i = step.firstOp, end = step.firstOp + step.numOps; i < end; ++i) {
+                uint64_t mask = uint64_t(1) << (ops[i].id % 64);
+                if (ops[i].kill) {
+                    kill[ops[i].id / 64] |= mask;
+                    gen[ops[i].id / 64] &= ~mask;
+                } else {
+                    gen[ops[i].id / 64] |= mask;
+                }
+            }
+        }
+    }
+
+    std::vector<const clang::CFGBlock*> blocks(numBlocks, nullptr);
+    for (const clang::CFGBlock* block : cfg) blocks[block->getBlockID()] = block;
+
+    // Postorder of the CFG from the entry, so successors are mostly solved before their predecessors.
+    // Blocks not reachable from the entry are analyzed too, like LiveVariables does.
+    std::vector<unsigned> order;
+    order.reserve(numBlocks);
+    llvm::BitVector visited(numBlocks);
+    std::vector<std::pair<const clang::CFGBlock*, clang::CFGBlock::const_succ_iterator>> stack;
+    auto postorder = [&](const clang::CFGBlock* root) {
+        if (visited.test(root->getBlockID())) return;
+        visited.set(root->getBlockID());
+        stack.push_back({root, root->succ_begin()});
+        while (!stack.empty()) {
+            const clang::CFGBlock* block = stack.back().first;
+            auto& it = stack.back().second;
+            if (it == block->succ_end()) {
+                order.push_back(block->getBlockID());
+                stack.pop_back();
+                continue;
+            }
+            const clang::CFGBlock* succ = *it++;
+            if (succ && !visited.test(succ->getBlockID())) {
+                visited.set(succ->getBlockID());
+                stack.push_back({succ, succ->succ_begin()});
+            }
+        }
+    };
+    postorder(&cfg.getEntry());
+    for (const clang::CFGBlock* block : cfg) postorder(block);
+
+    std::vector<unsigned> position(numBlocks, 0);
+    for (unsigned i = 0; i < order.size(); ++i) position[order[i]] = i;
+
+    // The worklist is a bitvector over postorder positions, always resumed at its lowest pending entry.
+    // Every block is processed at least once.
+    llvm::BitVector pending(static_cast<unsigned>(order.size()), true);
+    std::vector<uint64_t> in(words);
+    int pos = pending.find_first();
+    while (pos != -1) {
+        if (deadline.expired()) return false;
+        pending.reset(pos);
+        unsigned id = order[pos];
+        const clang::CFGBlock* block = blocks[id];
+
+        uint64_t* out = row(liveOut, id);
+        for (const clang::CFGBlock* succ : block->succs()) {
+            if (!succ) continue;
+            const uint64_t* succIn = row(liveIn, succ->getBlockID());
+            for (size_t w = 0; w < words; ++w) out[w] |= succIn[w];
+        }
+
+        const uint64_t* gen = row(gens, id);
+        const uint64_t* kill = row(kills, id);
+        uint64_t* blockIn = row(liveIn, id);
+        bool changed = false;
+        for (size_t w = 0; w < words; ++w) {
+            uint64_t value = (out[w] & ~kill[w]) | gen[w];
+            changed |= value != blockIn[w];
+            blockIn[w] = value;
+        }
+
+        int lowest = pos;
+        if (changed) {
+            for (const clang::CFGBlock* pred : block->preds()) {
+                if (!pred) continue;
+                int p = static_cast<int>(position[pred->getBlockID()]);
+                pending.set(p);
+                lowest = std::min(lowest, p);
+            }
+        }
+        pos = pending.test(lowest) ? lowest : pending.find_next(lowest);
+    }
+    return true;
+}
+
+// Replays each block like LiveVariables::runOnAllBlocks, starting from the block's live-out values
+void BitVectorLiveness::runOnAllBlocks(Observer& observer) const {
+    std::vector<uint64_t> bits(words);
+    for (const clang::CFGBlock* block : cfg) {
+        unsigned id = block->getBlockID();
+        std::copy_n(row(liveOut, id), words, bits.data());
+        Values values(*this, bits.data());
+        for (uint32_t s = blockSteps[id]; s < blockSteps[id + 1]; ++s) {
+            if (steps[s].stmt) observer.observeStmt(steps[s].stmt, block, values);
+            apply(steps[s], bits.data());
+        }
+    }
+}
+
+bool BitVectorLiveness::Values::test(const clang::Decl* D) const {
+    auto it = owner.ids.find(D);
+    if (it == owner.ids.end()) return false;
+    return bits[it->second / 64] & (uint64_t(1) << (it->second % 64));
+}
+
+bool BitVectorLiveness::Values::isLive(const clang::VarDecl* VD) const {
+    // A structured binding declaration is live as long as one of its bindings is
+    if (const auto* DD = llvm::dyn_cast<clang::DecompositionDecl>(VD)) {
+        for (const clang::BindingDecl* BD : DD->bindings()) {
+            if (test(BD)) return true;
+        }
+    }
+    return test(VD);
+}
+
+} // namespace myproject
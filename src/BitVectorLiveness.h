@@ -0,0 +1,90 @@
+#ifndef BIT_VECTOR_LIVENESS_H
+#define BIT_VECTOR_LIVENESS_H
+
+#include <clang/AST/Decl.h>
+#include <clang/AST/Stmt.h>
+#include <clang/Analysis/AnalysisDeclContext.h>
+#include <clang/Analysis/CFG.h>
+#include <llvm/ADT/DenseMap.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "FunctionBudget.h"
+
+namespace myproject {
+
+// Variable liveness with the same transfer functions as clang::LiveVariables (killAtAssign mode), but
+// stored as dense bitvectors instead of ImmutableSet trees. The variables of the function are numbered
+// 0..N-1, every block keeps its live-in/live-out sets as N-bit word-packed rows of one flat array, and the
+// fixpoint is computed with a worklist ordered by the CFG postorder (reverse postorder of the reverse CFG).
+//
+// Obtained through AnalysisDeclContext::getAnalysis<BitVectorLiveness>(), so it is cached with the CFG, or
+// through create() with a Deadline that the fixpoint polls on every block it visits.
+class BitVectorLiveness : public clang::ManagedAnalysis {
+public:
+    // Liveness at one program point, only valid during an observer callback
+    class Values {
+    public:
+        Values(const BitVectorLiveness& owner, const uint64_t* bits) : owner(owner), bits(bits) {}
+        bool isLive(const clang::VarDecl* VD) const;
+    private:
+        bool test(const clang::Decl* D) const;
+        const BitVectorLiveness& owner;
+        const uint64_t* bits;
+    };
+
+    // Same contract as clang::LiveVariables::Observer: `live` holds the values right after S
+    class Observer {
+    public:
+        virtual ~Observer() = default;
+        virtual void observeStmt(const clang::Stmt* S, const clang::CFGBlock* block, const Values& live) {}
+    };
+
+    static const void* getTag();
+    static std::unique_ptr<BitVectorLiveness> create(clang::AnalysisDeclContext& AC);
+    // nullptr when `deadline` expires before the fixpoint is reached
+    static std::unique_ptr<BitVectorLiveness> create(clang::AnalysisDeclContext& AC, Deadline& deadline);
+
+    // Replay every block from its live-out values and call the observer before each statement's transfer
+    void runOnAllBlocks(Observer& observer) const;
+
+    unsigned getNumVariables() const { return static_cast<unsigned>(decls.size()); }
+
+private:
+    // One gen or kill of a numbered declaration
+    struct Op {
+        uint32_t id : 31;
+        uint32_t kill : 1;
+    };
+    // The transfer of one CFG element. `stmt` is null for elements the observer does not see (destructors)
+    struct Step {
+        const clang::Stmt* stmt;
+        uint32_t firstOp;
+        uint32_t numOps;
+    };
+
+    explicit BitVectorLiveness(const clang::CFG& cfg) : cfg(cfg) {}
+
+    void buildSteps(clang::AnalysisDeclContext& AC);
+    bool solve(Deadline& deadline);
+    unsigned getId(const clang::Decl* D);
+    void apply(const Step& step, uint64_t* row) const;
+
+    uint64_t* row(std::vector<uint64_t>& rows, unsigned block) { return rows.data() + size_t(block) * words; }
+    const uint64_t* row(const std::vector<uint64_t>& rows, unsigned block) const { return rows.data() + size_t(block) * words; }
+
+    const clang::CFG& cfg;
+    llvm::DenseMap<const clang::Decl*, unsigned> ids;
+    std::vector<const clang::Decl*> decls;
+    size_t words = 0;
+
+    std::vector<Op> ops;
+    std::vector<Step> steps;
+    std::vector<uint32_t> blockSteps; // Steps of block b are [blockSteps[b], blockSteps[b + 1])
+
+    std::vector<uint64_t> liveIn, liveOut; // numBlocks * words
+};
+
+} // namespace myproject
+
+#endif // BIT_VECTOR_LIVENESS_H
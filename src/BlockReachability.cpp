@@ -0,0 +1,72 @@
+#include "BlockReachability.h"
+#include <algorithm>
+
+namespace myproject {
+
+void BlockReachability::compute(const clang::CFG& cfg) {
+    unsigned numBlocks = cfg.getNumBlockIDs();
+    // reset() keeps the words allocated, resize() only grows them for a bigger CFG
+    reachable.reset();
+    reachable.resize(numBlocks);
+    blocks.assign(numBlocks, nullptr);
+    for (const clang::CFGBlock* block : cfg) blocks[block->getBlockID()] = block;
+    exitID = cfg.getExit().getBlockID();
+
+    // Depth-first, the order does not matter for reachability and a stack is the cheapest worklist
+    worklist.clear();
+    const clang::CFGBlock* entry = &cfg.getEntry();
+    reachable.set(entry->getBlockID());
+    worklist.push_back(entry);
+    while (!worklist.empty()) {
+        const clang::CFGBlock* block = worklist.back();
+        worklist.pop_back();
+        for (const clang::CFGBlock* succ : block->succs()) {
+            if (succ && !reachable.test(succ->getBlockID())) {
+                reachable.set(succ->getBlockID());
+                worklist.push_back(succ);
+            }
+        }
+    }
+    numReachable = reachable.count();
+}
+
+void BlockReachability::forEachUnreachableRegion(llvm::function_ref<void(llvm::ArrayRef<const clang::CFGBlock*>)> region) {
+    unsigned numBlocks = static_cast<unsigned>(blocks.size());
+    if (numReachable == numBlocks) return;
+
+    // Start from the reachable blocks and the exit so the flood fill stops at them. Every return leads to
+    // the exit, it would join the dead code after unrelated returns when the end of the function is unreachable.
+    grouped = reachable;
+    grouped.set(exitID);
+    auto visit = [this](const clang::CFGBlock* next) {
+        if (next && !grouped.test(next->getBlockID())) {
+            grouped.set(next->getBlockID());
+            worklist.push_back(next);
+        }
+    };
+    auto isHead = [this](const clang::CFGBlock* block) {
+        return std::none_of(block->pred_begin(), block->pred_end(),
+                            [this](const clang::CFGBlock* pred) { return pred && !reachable.test(pred->getBlockID()); });
+    };
+    // The heads first, then whatever is left: cycles no head leads into
+    for (bool headsOnly : {true, false}) {
+        for (unsigned id = numBlocks; id-- > 0;) {
+            const clang::CFGBlock* first = blocks[id];
+            if (!first || grouped.test(id) || (headsOnly && !isHead(first))) continue;
+
+            members.clear();
+            visit(first);
+            while (!worklist.empty()) {
+                const clang::CFGBlock* block = worklist.back();
+                worklist.pop_back();
+                members.push_back(block);
+                for (const clang::CFGBlock* succ : block->succs()) visit(succ);
+            }
+            std::sort(members.begin(), members.end(),
+                      [](const clang::CFGBlock* a, const clang::CFGBlock* b) { return a->getBlockID() > b->getBlockID(); });
+            region(members);
+        }
+    }
+}
+
+} // namespace myproject
@@ -0,0 +1,43 @@
+#ifndef BLOCK_REACHABILITY_H
+#define BLOCK_REACHABILITY_H
+
+#include <clang/Analysis/CFG.h>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/STLExtras.h>
+#include <vector>
+
+namespace myproject {
+
+// Which blocks of a CFG can be reached from its entry, as a dense bitvector indexed by block ID. The
+// bitvectors and the flat worklist keep their capacity between functions, so one engine per thread serves
+// every function it analyzes without allocating again.
+class BlockReachability {
+public:
+    // Mark the blocks reachable from the entry of `cfg`, replacing the result for the previous CFG
+    void compute(const clang::CFG& cfg);
+
+    bool isReachable(unsigned blockID) const { return reachable.test(blockID); }
+    unsigned getNumReachable() const { return numReachable; }
+
+    // Group the unreachable blocks of the last computed CFG into regions and call `region` once per region. A
+    // region starts at a head, an unreachable block without unreachable predecessors, and holds the blocks its
+    // successor edges reach that no earlier region took, so dead code after two returns stays two regions
+    // even where it joins. Unreachable cycles without a head come last. The exit block is never part of one.
+    // The blocks of a region come highest ID first, which is their source order since the CFG is built from
+    // the end of the function; the regions come in the same order.
+    void forEachUnreachableRegion(llvm::function_ref<void(llvm::ArrayRef<const clang::CFGBlock*>)> region);
+
+private:
+    llvm::BitVector reachable;
+    llvm::BitVector grouped; // Unreachable blocks already part of a region
+    std::vector<const clang::CFGBlock*> blocks; // By ID
+    std::vector<const clang::CFGBlock*> worklist;
+    std::vector<const clang::CFGBlock*> members;
+    unsigned numReachable = 0;
+    unsigned exitID = 0;
+};
+
+} // namespace myproject
+
+#endif // BLOCK_REACHABILITY_H
@@ -0,0 +1,152 @@
+#include "ChangedLines.h"
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+
+namespace myproject {
+
+std::optional<ChangedLines> ChangedLines::read(llvm::StringRef path) {
+    auto buffer = llvm::MemoryBuffer::getFileOrSTDIN(path);
+    if (!buffer) {
+        llvm::errs() << "Cannot read changed lines " << path << ": " << buffer.getError().message() << "\n";
+        return std::nullopt;
+    }
+
+    std::optional<ChangedLines> changed = parse((*buffer)->getBuffer());
+    if (!changed) llvm::errs() << "Cannot parse changed lines " << path << ": expected a unified diff or a JSON object\n";
+    return changed;
+}
+
+std::optional<ChangedLines> ChangedLines::parse(llvm::StringRef text) {
+    ChangedLines changed;
+    bool parsed = text.ltrim().startswith("{") ? changed.parseJSON(text) : changed.parseDiff(text);
+    if (!parsed) return std::nullopt;
+    changed.normalize();
+    return changed;
+}
+
+// Only the new side matters: added lines are changed, and a deletion changes the line that follows it.
+// The lines of a hunk are counted off against both sides of its "@@" header, whatever text they hold, so a
+// deleted "-- x" or an added "++ x" is never taken for a file header. Headers are only read between hunks.
+bool ChangedLines::parseDiff(llvm::StringRef text) {
+    llvm::StringRef file;
+    unsigned line = 0;         // Next line of the new file in the current hunk
+    unsigned oldRemaining = 0; // Lines of the old side left in the current hunk
+    unsigned newRemaining = 0; // Lines of the new side left in the current hunk
+
+    // -a[,b] or +c[,d], the count is 1 when left out
+    auto parseSide = [](llvm::StringRef side, char sign, unsigned& start, unsigned& count) {
+        if (!side.consume_front(llvm::StringRef(&sign, 1))) return false;
+        auto [first, length] = side.split(',');
+        count = 1;
+        return !first.getAsInteger(10, start) && (length.empty() || !length.getAsInteger(10, count));
+    };
+
+    while (!text.empty()) {
+        llvm::StringRef current;
+        std::tie(current, text) = text.split('\n');
+        current = current.rtrim("\r");
+
+        if (oldRemaining || newRemaining) {
+            // Some tools strip the space of an empty context line
+            char kind = current.empty() ? ' ' : current.front();
+            if (kind == '+') {
+                if (!newRemaining) return false;
+                if (!file.empty()) add(file, line, line);
+                ++line;
+                --newRemaining;
+            } else if (kind == '-') {
+                if (!oldRemaining) return false;
+                if (!file.empty() && line) add(file, line, line);
+                --oldRemaining;
+            } else if (kind == ' ') {
+                if (!oldRemaining || !newRemaining) return false;
+                ++line;
+                --oldRemaining;
+                --newRemaining;
+            } else if (kind != '\\') { // "\ No newline at end of file"
+                return false;
+            }
+        } else if (current.startswith("+++ ")) {
+            file = current.drop_front(4).split('\t').first.trim();
+            if (file == "/dev/null") file = ""; // Deleted file
+            else if (file.startswith("b/")) file = file.drop_front(2);
+        } else if (current.startswith("@@ ")) {
+            // @@ -a[,b] +c[,d] @@
+            auto [oldSide, rest] = current.drop_front(3).split(' ');
+            llvm::StringRef newSide = rest.split(' ').first;
+            unsigned a = 0, c = 0;
+            if (!parseSide(oldSide, '-', a, oldRemaining) || !parseSide(newSide, '+', c, newRemaining)) return false;
+            line = c;
+            // A hunk that only deletes lines still touches the function it was in
+            if (newRemaining == 0 && !file.empty()) add(file, std::max(c, 1u), std::max(c, 1u));
+        }
+        // Anything else between hunks is a header ("diff", "index", "---") or commentary
+    }
+    return true;
+}
+
+bool ChangedLines::parseJSON(llvm::StringRef text) {
+    llvm::Expected<llvm::json::Value> value = llvm::json::parse(text);
+    if (!value) {
+        llvm::consumeError(value.takeError());
+        return false;
+    }
+    const llvm::json::Object* object = value->getAsObject();
+    if (!object) return false;
+
+    for (const auto& [file, ranges] : *object) {
+        const llvm::json::Array* array = ranges.getAsArray();
+        if (!array) return false;
+        for (const llvm::json::Value& range : *array) {
+            const llvm::json::Array* pair = range.getAsArray();
+            if (!pair || pair->size() != 2) return false;
+            auto first = (*pair)[0].getAsUINT64();
+            auto last = (*pair)[1].getAsUINT64();
+            if (!first || !last || *first > *last) return false;
+            add(llvm::StringRef(file), static_cast<unsigned>(*first), static_cast<unsigned>(*last));
+        }
+    }
+    return true;
+}
+
+void ChangedLines::add(llvm::StringRef file, unsigned first, unsigned last) {
+    files[file].push_back({first, last});
+}
+
+// Sort and merge adjacent ranges, so lookups are a binary search
+void ChangedLines::normalize() {
+    for (auto& entry : files) {
+        std::vector<Range>& ranges = entry.second;
+        std::sort(ranges.begin(), ranges.end());
+        std::vector<Range> merged;
+        for (const Range& range : ranges) {
+            if (!merged.empty() && range.first <= merged.back().second + 1)
+                merged.back().second = std::max(merged.back().second, range.second);
+            else
+                merged.push_back(range);
+        }
+        ranges = std::move(merged);
+    }
+}
+
+const std::vector<ChangedLines::Range>* ChangedLines::find(llvm::StringRef file) const {
+    auto it = files.find(file);
+    if (it != files.end()) return &it->second;
+    for (const auto& entry : files) {
+        llvm::StringRef name = entry.first();
+        if (file.endswith(name) && (file.size() == name.size() || file[file.size() - name.size() - 1] == '/'))
+            return &entry.second;
+    }
+    return nullptr;
+}
+
+bool ChangedLines::overlaps(const std::vector<Range>& ranges, unsigned first, unsigned last) {
+    // First range that ends at or after `first`
+    auto it = std::lower_bound(ranges.begin(), ranges.end(), first,
+                               [](const Range& range, unsigned line) { return range.second < line; });
+    return it != ranges.end() && it->first <= last;
+}
+
+} // namespace myproject
@@ -0,0 +1,44 @@
+#ifndef CHANGED_LINES_H
+#define CHANGED_LINES_H
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace myproject {
+
+// Lines touched by a patch, by file (--changed-lines). Read from a unified diff (the new side of every
+// hunk) or from JSON like {"src/a.cpp": [[10, 20], [42, 42]]}. File names match the compiler's paths
+// exactly or as a path suffix, so paths relative to the repository root work.
+class ChangedLines {
+public:
+    // Inclusive line range, 1-based
+    using Range = std::pair<unsigned, unsigned>;
+
+    // Prints the problem and returns std::nullopt if the file cannot be read or parsed
+    static std::optional<ChangedLines> read(llvm::StringRef path);
+    // The same from text, std::nullopt if it is neither a diff nor the JSON form
+    static std::optional<ChangedLines> parse(llvm::StringRef text);
+
+    // The sorted, disjoint ranges of `file`, nullptr if nothing in it changed
+    const std::vector<Range>* find(llvm::StringRef file) const;
+
+    // True if [first, last] overlaps one of `ranges`
+    static bool overlaps(const std::vector<Range>& ranges, unsigned first, unsigned last);
+
+    const llvm::StringMap<std::vector<Range>>& getFiles() const { return files; }
+
+private:
+    bool parseDiff(llvm::StringRef text);
+    bool parseJSON(llvm::StringRef text);
+    void add(llvm::StringRef file, unsigned first, unsigned last);
+    void normalize();
+
+    llvm::StringMap<std::vector<Range>> files;
+};
+
+} // namespace myproject
+
+#endif // CHANGED_LINES_H
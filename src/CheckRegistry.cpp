@@ -0,0 +1,32 @@
+#include "CheckRegistry.h"
+#include <llvm/Support/raw_ostream.h>
+
+namespace myproject {
+
+// Function-local so it exists before the first RegisterCheck runs, whatever the static initialization order
+std::vector<std::pair<std::string, CheckRegistry::Factory>>& CheckRegistry::checks() {
+    static std::vector<std::pair<std::string, Factory>> registered;
+    return registered;
+}
+
+void CheckRegistry::add(std::string name, Factory factory) {
+    checks().emplace_back(std::move(name), factory);
+}
+
+std::unique_ptr<CheckStrategy> CheckRegistry::create(const std::string& name, const CheckOptions& options) {
+    for (const auto& [registered, factory] : checks()) {
+        if (registered == name) return factory(name, options);
+    }
+    llvm::errs() << "Unknown matcher type: " << name << " (available:";
+    for (const auto& entry : checks()) llvm::errs() << " " << entry.first;
+    llvm::errs() << ")\n";
+    return nullptr;
+}
+
+std::vector<std::string> CheckRegistry::names() {
+    std::vector<std::string> result;
+    for (const auto& entry : checks()) result.push_back(entry.first);
+    return result;
+}
+
+} // namespace myproject
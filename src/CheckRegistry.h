@@ -0,0 +1,59 @@
+#ifndef CHECK_REGISTRY_H
+#define CHECK_REGISTRY_H
+
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "CheckStrategies.h"
+
+// Which liveness implementation feeds the dead-stores observer. Both report the same dead stores.
+enum class LivenessEngine {
+    BitVector,  // myproject::BitVectorLiveness, dense bitvectors
+    Clang       // clang::LiveVariables, ImmutableSet based
+};
+
+namespace myproject {
+
+// Command line settings a check may take into account when it is created
+struct CheckOptions {
+    LivenessEngine liveness = LivenessEngine::BitVector;
+};
+
+// Every check linked into the binary, by name. Checks add themselves with a RegisterCheck object next to
+// their class, so the tool and the bench find a new check without a list of names to keep up to date.
+class CheckRegistry {
+public:
+    using Factory = std::unique_ptr<CheckStrategy> (*)(const std::string& name, const CheckOptions& options);
+
+    // Called during static initialization by RegisterCheck
+    static void add(std::string name, Factory factory);
+
+    // A new instance of the check, nullptr (with an error on stderr) if there is no such check
+    static std::unique_ptr<CheckStrategy> create(const std::string& name, const CheckOptions& options = {});
+
+    // In registration order
+    static std::vector<std::string> names();
+
+private:
+    static std::vector<std::pair<std::string, Factory>>& checks();
+};
+
+// Registers T under `name`. T is built from (name, options) if it has such a constructor, otherwise from the name.
+template <typename T>
+struct RegisterCheck {
+    explicit RegisterCheck(const char* name) {
+        static_assert(std::is_base_of_v<CheckStrategy, T>, "checks derive from CheckStrategy");
+        CheckRegistry::add(name, [](const std::string& name, const CheckOptions& options) -> std::unique_ptr<CheckStrategy> {
+            if constexpr (std::is_constructible_v<T, const std::string&, const CheckOptions&>)
+                return std::make_unique<T>(name, options);
+            else
+                return std::make_unique<T>(name);
+        });
+    }
+};
+
+} // namespace myproject
+
+#endif // CHECK_REGISTRY_H
@@ -1,25 +1,75 @@
 #pragma once
 
 #include <clang/ASTMatchers/ASTMatchers.h>
-#include <clang/ASTMatchers/Dynamic/VariantValue.h>
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "AnalysisCache.h"
+#include "Arena.h"
+#include "Findings.h"
+#include "FunctionBudget.h"
+#include "Log.h"
 #include <vector>
 #include <optional>
 
+namespace myproject {
+
+// Everything a check needs besides the match itself. In the parallel function mode every worker
+// has its own context, so nothing in here is shared between threads.
+struct CheckContext {
+    AnalysisCache& cache;    // CFGs and analyses, use it instead of building CFGs locally
+    FindingSink& findings;   // Where findings go instead of the DiagnosticsEngine
+    Deadline deadline{};     // Poll it in long loops, give up on the function (return false) once it expired
+    Arena* arena = nullptr;  // For temporaries that die with check(), see ArenaVector. Null means the heap.
+};
+
+// How a check takes part in the fused walker (MyMatchCallback::setFusedWalker). Instead of its matchers, the
+// walker asks it about every function definition once, and about the statements of the body while walking
+// it, so the TU is traversed a single time for all checks. The answers must agree with the check's function
+// matcher. The visitor is only asked from the thread that owns the AST, and it keeps no per-function state.
+class FunctionVisitor {
+public:
+    enum class Interest {
+        No,         // The check does not analyze the function
+        Yes,        // It does
+        IfAnyStmt   // It does if matchesStmt() is true for any statement of the body
+    };
+    virtual ~FunctionVisitor() = default;
+
+    // The name the check's function matcher binds the FunctionDecl to, check() gets a match with that binding
+    virtual llvm::StringRef getFunctionBinding() const = 0;
+    virtual Interest interest(const clang::FunctionDecl* FD, const clang::SourceManager& sm) const = 0;
+    virtual bool matchesStmt(const clang::Stmt* S) const { return false; }
+};
+
+} // namespace myproject
+
 class CheckStrategy {
 public:
     CheckStrategy(const std::string& name) : name_(name) {}
     virtual ~CheckStrategy() = default;
 
-    // Simplify the type name
-    using MatchersList = std::vector<clang::ast_matchers::dynamic::VariantMatcher>;
-    
+    // The typed matchers of a check, each one is registered with the MatchFinder as it is
+    struct MatchersList {
+        std::vector<clang::ast_matchers::DeclarationMatcher> declarations;
+        std::vector<clang::ast_matchers::StatementMatcher> statements;
+    };
+
     // Return a list of matchers
     virtual MatchersList getMatchers() const = 0;
-    virtual std::optional<bool> check(const clang::ast_matchers::MatchFinder::MatchResult& result) = 0;
+    virtual std::optional<bool> check(const clang::ast_matchers::MatchFinder::MatchResult& result,
+                                      myproject::CheckContext& context) = 0;
+
+    // The function this match analyzes on its own, or nullptr. Returning a function means check() only
+    // reads the AST and the function's CFG and keeps no state in the check object, so it may run on a
+    // worker thread at the same time as check() for another function.
+    virtual const clang::FunctionDecl* analyzedFunction(const clang::ast_matchers::MatchFinder::MatchResult& result) const { return nullptr; }
+
+    // Non-null if the check can run under the fused walker, its matchers are then not used there
+    virtual const myproject::FunctionVisitor* getFunctionVisitor() const { return nullptr; }
+
+    // Called after each TU, checks keeping per-TU state reset it here since the check object is reused for the next TU
+    virtual void onEndOfTranslationUnit() {}
 
     const std::string& getName() const { return name_; }
 private:
     std::string name_;
 };
-
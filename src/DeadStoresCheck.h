@@ -1,44 +1,64 @@
 # pragma once
 
 #include "CheckStrategies.h"
+#include "CheckRegistry.h"
 #include <clang/Analysis/CFG.h>
 #include <clang/Analysis/AnalysisDeclContext.h>
 #include <clang/Analysis/Analyses/LiveVariables.h>
 #include "clang/AST/Attr.h"
+#include "BitVectorLiveness.h"
+#include <llvm/ADT/STLExtras.h>
+#include <format>
 
 
-class DeadStoresCheck : public CheckStrategy {
+class DeadStoresCheck : public CheckStrategy, public myproject::FunctionVisitor {
 friend class DeadStoreObserver;
 public:
-DeadStoresCheck(const std::string& name) : CheckStrategy(name) {}
+DeadStoresCheck(const std::string& name, LivenessEngine engine = LivenessEngine::BitVector) : CheckStrategy(name), engine(engine) {}
+DeadStoresCheck(const std::string& name, const myproject::CheckOptions& options) : DeadStoresCheck(name, options.liveness) {}
 MatchersList getMatchers() const override {
     using namespace clang::ast_matchers;
-    using cadv = clang::ast_matchers::dynamic::VariantMatcher;
     
     // Create a list of matchers
     MatchersList matchers;
     // 1. Find all function declarations
-    matchers.push_back(cadv::SingleMatcher(
-            functionDecl(isExpansionInMainFile()).bind("funcDecl"))
-    );
+    matchers.declarations.push_back(functionDecl(isExpansionInMainFile()).bind("funcDecl"));
     // 2. Find all loop statements
-    matchers.push_back(cadv::SingleMatcher(stmt(anyOf(
+    matchers.statements.push_back(stmt(anyOf(
                     forStmt().bind("forLoop"),
                     whileStmt().bind("whileLoop"),
                     doStmt().bind("doLoop")
                 ), isExpansionInMainFile()
             )
-        )
     );
     
     return matchers;
 }
 
-std::optional<bool> check(const clang::ast_matchers::MatchFinder::MatchResult& result) override;
+std::optional<bool> check(const clang::ast_matchers::MatchFinder::MatchResult& result, myproject::CheckContext& context) override;
+
+// Only the function matcher does any work, and it only touches the function's own CFG
+const clang::FunctionDecl* analyzedFunction(const clang::ast_matchers::MatchFinder::MatchResult& result) const override {
+    const auto *funcDecl = result.Nodes.getNodeAs<clang::FunctionDecl>("funcDecl");
+    return funcDecl && funcDecl->hasBody() ? funcDecl : nullptr;
+}
+
+// Under the fused walker only the function matcher is needed, the loop matcher finds nothing to do
+const myproject::FunctionVisitor* getFunctionVisitor() const override { return this; }
+llvm::StringRef getFunctionBinding() const override { return "funcDecl"; }
+Interest interest(const clang::FunctionDecl* FD, const clang::SourceManager& sm) const override {
+    return sm.isInMainFile(sm.getExpansionLoc(FD->getBeginLoc())) ? Interest::Yes : Interest::No;
+}
+
+private:
+LivenessEngine engine;
 };
 
-// Inheriting from clang::LiveVariables::Observer, the program can perform custom analysis on the liveness of variables by running runOnAllBlocks(*observer)
-class DeadStoreObserver : public clang::LiveVariables::Observer {
+inline const myproject::RegisterCheck<DeadStoresCheck> registerDeadStoresCheck("dead-stores");
+
+// Inheriting from clang::LiveVariables::Observer, the program can perform custom analysis on the liveness of variables by running runOnAllBlocks(*observer).
+// The same observer is driven by myproject::BitVectorLiveness, which calls it at the same program points.
+class DeadStoreObserver : public clang::LiveVariables::Observer, public myproject::BitVectorLiveness::Observer {
 public:
 const clang::ast_matchers::MatchFinder::MatchResult& result;
 
@@ -47,9 +67,21 @@ struct DeadStoreInfo {
     const clang::Expr *Ex;
 };
 
-DeadStoreObserver(const clang::ast_matchers::MatchFinder::MatchResult& r) : result(r) {}
+// Lives on the stack of check(), its dead stores go to the check's arena
+DeadStoreObserver(const clang::ast_matchers::MatchFinder::MatchResult& r, myproject::FindingSink& findings,
+                  const std::string& checkName, const clang::FunctionDecl* function, myproject::CheckContext& context)
+    : result(r), ReportStack(myproject::ArenaAllocator<DeadStoreInfo>(context.arena)), findings(findings),
+      checkName(checkName), function(function), deadline(context.deadline) {}
 
-void observeStmt(const clang::Stmt* S, const clang::CFGBlock* currentBlock, const clang::LiveVariables::LivenessValues& Live) final;
+// Once the deadline expired the remaining statements are skipped, the check then drops what was found
+void observeStmt(const clang::Stmt* S, const clang::CFGBlock* currentBlock, const clang::LiveVariables::LivenessValues& Live) final {
+    if (deadline.expired()) return;
+    observe(S, [&Live](const clang::VarDecl* VD) { return Live.isLive(VD); });
+}
+void observeStmt(const clang::Stmt* S, const clang::CFGBlock* currentBlock, const myproject::BitVectorLiveness::Values& Live) final {
+    if (deadline.expired()) return;
+    observe(S, [&Live](const clang::VarDecl* VD) { return Live.isLive(VD); });
+}
 
 // Reverse iterate through the stack to report dead stores in order
 void reportAllDeadStores() const {
@@ -59,18 +91,25 @@ void reportAllDeadStores() const {
 }
 
 private:
-mutable std::vector<DeadStoreInfo> ReportStack;  // Stack to store dead stores
+mutable myproject::ArenaVector<DeadStoreInfo> ReportStack;  // Stack to store dead stores
+myproject::FindingSink& findings;
+const std::string& checkName;
+const clang::FunctionDecl* function; // Its name is only built for a report
+myproject::Deadline& deadline;
+
+using LivenessQuery = llvm::function_ref<bool(const clang::VarDecl*)>;
 
+void observe(const clang::Stmt* S, LivenessQuery isLive);
 std::optional<bool> reportDeadStore(const clang::VarDecl *VD, const clang::Expr *Ex) const;
 std::optional<bool> CheckVarDecl(const clang::VarDecl *VD, const clang::Expr *Ex,
-                                 const clang::LiveVariables::LivenessValues &Live,
+                                 LivenessQuery isLive,
                                  const clang::ast_matchers::MatchFinder::MatchResult &result) const;
 
 };
 
 
 // So many buggy issues not checking in the function
-void DeadStoreObserver::observeStmt(const clang::Stmt* S, const clang::CFGBlock* currentBlock, const clang::LiveVariables::LivenessValues& Live){
+void DeadStoreObserver::observe(const clang::Stmt* S, LivenessQuery isLive){
     // Skip statements in macros.
     if (S->getBeginLoc().isMacroID())
         return;
@@ -89,8 +128,8 @@ void DeadStoreObserver::observeStmt(const clang::Stmt* S, const clang::CFGBlock*
                         return; // Skip self-assignment
                 }
                 // Check if the variable declaration might be a dead store
-                if(!CheckVarDecl(VD, DR, Live, result)) {
-                    llvm::outs() << "CheckVarDecl failed\n";
+                if(!CheckVarDecl(VD, DR, isLive, result)) {
+                    llvm::errs() << "CheckVarDecl failed\n";
                     std::abort();
                 }
                 else return;
@@ -124,7 +163,7 @@ void DeadStoreObserver::observeStmt(const clang::Stmt* S, const clang::CFGBlock*
                     continue;
 
                 // Check if the variable declaration might be a dead store
-                if (!Live.isLive(V) && !V->hasAttr<clang::UnusedAttr>()) {
+                if (!isLive(V) && !V->hasAttr<clang::UnusedAttr>()) {
                     // Pass the variable declaration and the initializer expression to the report stack
                     ReportStack.push_back({V, E});
                     return;
@@ -139,16 +178,14 @@ std::optional<bool> DeadStoreObserver::reportDeadStore(const clang::VarDecl *VD,
     if (!VD || !Ex) return std::nullopt;  // Error if pointers are null
     
     clang::SourceLocation Loc = Ex->getExprLoc();
-    clang::DiagnosticsEngine &Diag = result.Context->getDiagnostics();
-    unsigned DiagID = Diag.getCustomDiagID(clang::DiagnosticsEngine::Warning,
-                                           "Value stored to '%0' is never read");
-    Diag.Report(Loc, DiagID) << VD->getName();
+    findings.report({checkName, Loc, std::format("Value stored to '{}' is never read", VD->getName().str()),
+                     function->getQualifiedNameAsString()});
     return true;
 }
 
 // CheckVarDecl implementation with error handling
 std::optional<bool> DeadStoreObserver::CheckVarDecl(const clang::VarDecl *VD, const clang::Expr *Ex,
-                                                    const clang::LiveVariables::LivenessValues &Live,
+                                                    LivenessQuery isLive,
                                                     const clang::ast_matchers::MatchFinder::MatchResult &result) const {
     if (!VD || !Ex) return std::nullopt;  // Error if pointers are null
 
@@ -156,35 +193,40 @@ std::optional<bool> DeadStoreObserver::CheckVarDecl(const clang::VarDecl *VD, co
 
     if (VD->getType()->getAs<clang::ReferenceType>()) return true;  // Skip reference types
 
-    if (!Live.isLive(VD) && !VD->hasAttr<clang::UnusedAttr>()) ReportStack.push_back({VD, Ex});  // Report dead store if conditions met
+    if (!isLive(VD) && !VD->hasAttr<clang::UnusedAttr>()) ReportStack.push_back({VD, Ex});  // Report dead store if conditions met
 
     return true;
 }
 
-std::optional<bool> DeadStoresCheck::check(const clang::ast_matchers::MatchFinder::MatchResult& result){ 
+std::optional<bool> DeadStoresCheck::check(const clang::ast_matchers::MatchFinder::MatchResult& result, myproject::CheckContext& context){ 
     if(auto funcDecl = result.Nodes.getNodeAs<clang::FunctionDecl>("funcDecl")) {
         clang::ASTContext *astContext = result.Context;
         clang::Stmt *funcBody = funcDecl->getBody();
         if (!funcBody) return false;
     
-        llvm::outs() << std::format("FUNCTION: {}\n", funcDecl->getQualifiedNameAsString());
-        // 获取当前函数的 CFG
-        clang::AnalysisDeclContextManager manager(*astContext);
-        clang::AnalysisDeclContext *AC = manager.getContext(funcDecl);
-        AC->getCFGBuildOptions().setAllAlwaysAdd();//why？？？？加了这行以后就可以生成正常CFG了
-        //AC->getCFGBuildOptions().AddLifetime = true;
-        const clang::CFG *cfg = AC->getCFG();
+        MYPROJECT_TRACE("FUNCTION: {}", funcDecl->getQualifiedNameAsString());
+        // 获取当前函数的 CFG (shared with the other checks, built with setAllAlwaysAdd)
+        clang::AnalysisDeclContext *AC = context.cache.getContext(funcDecl, *astContext);
+        const clang::CFG *cfg = AC ? AC->getCFG() : nullptr;
         if (!cfg) {
             llvm::errs() << "Could not generate CFG for function.\n";
             return false;
         }
-        // 构建 LiveVariables 分析器
-        clang::LiveVariables* liveVars = AC->getAnalysis<clang::LiveVariables>(); 
-        if (!liveVars) return false;
-        auto observer = std::make_unique<DeadStoreObserver>(result);
-        assert(observer);
-        liveVars->runOnAllBlocks(*observer);
-        observer->reportAllDeadStores();
+        DeadStoreObserver observer(result, context.findings, getName(), funcDecl, context);
+        if (engine == LivenessEngine::Clang) {
+            // 构建 LiveVariables 分析器
+            // Its fixpoint runs to the end in one call, the deadline is only seen once the observer runs
+            clang::LiveVariables* liveVars = AC->getAnalysis<clang::LiveVariables>(); 
+            if (!liveVars) return false;
+            liveVars->runOnAllBlocks(observer);
+        } else {
+            // Not cached with the CFG: dead-stores is its only user, and the fixpoint has to see the deadline
+            auto liveness = myproject::BitVectorLiveness::create(*AC, context.deadline);
+            if (!liveness) return false;
+            liveness->runOnAllBlocks(observer);
+        }
+        if (context.deadline.wasExpired()) return false;
+        observer.reportAllDeadStores();
     }   
     return true;
 }
@@ -0,0 +1,166 @@
+#include "Findings.h"
+#include <clang/Basic/SourceManager.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/JSON.h>
+#include <format>
+
+namespace myproject {
+
+// Every SARIF result is preceded by this, FindingWriter::write drops it in front of the first one
+static constexpr llvm::StringLiteral sarifSeparator = ",\n";
+
+// Hand records to the writer once a batch gets this big, a TU with many findings does not keep them all
+static constexpr size_t maxBatchSize = 64 * 1024;
+
+// The SARIF artifactLocation.uri of `path`: absolute paths (POSIX, or Windows with a drive letter) become
+// file URIs, relative ones URI references. Everything but the unreserved characters and the separators is
+// percent-encoded (RFC 3986), so spaces and '%' in file names stay valid.
+static std::string fileURI(llvm::StringRef path) {
+    bool drive = path.size() >= 2 && llvm::isAlpha(path[0]) && path[1] == ':';
+    std::string uri;
+    if (!path.empty() && path.front() == '/') uri = "file://";
+    else if (drive) uri = "file:///";
+    for (size_t i = 0; i < path.size(); ++i) {
+        char c = path[i];
+        if (drive && c == '\\') c = '/';
+        if (llvm::isAlnum(c) || c == '-' || c == '.' || c == '_' || c == '~' || c == '/' || (drive && i == 1))
+            uri += c;
+        else
+            uri += std::format("%{:02X}", static_cast<unsigned char>(c));
+    }
+    return uri;
+}
+
+FindingWriter::FindingWriter(OutputFormat format, llvm::raw_ostream& os, const std::vector<std::string>& checks)
+    : format(format), os(os) {
+    if (format != OutputFormat::SARIF) return;
+
+    llvm::json::Array rules;
+    for (const auto& check : checks) rules.push_back(llvm::json::Object{{"id", check}});
+    llvm::json::Object driver{{"name", "tool"}, {"rules", std::move(rules)}};
+    os << R"({"version":"2.1.0","$schema":"https://json.schemastore.org/sarif-2.1.0.json","runs":[{"tool":{"driver":)"
+       << llvm::json::Value(std::move(driver)) << R"(},"results":[)" << "\n";
+}
+
+void FindingWriter::formatRecord(std::string& batch, const ResolvedFinding& finding) const {
+    llvm::StringRef file = finding.file;
+    unsigned line = finding.line, column = finding.column;
+    llvm::raw_string_ostream out(batch);
+    llvm::json::OStream json(out);
+    if (format == OutputFormat::JSONL) {
+        json.object([&] {
+            json.attribute("check", finding.check);
+            json.attribute("file", file);
+            json.attribute("line", line);
+            json.attribute("column", column);
+            json.attribute("message", finding.message);
+            json.attribute("function", finding.function);
+        });
+        out << "\n";
+        return;
+    }
+
+    out << sarifSeparator;
+    json.object([&] {
+        json.attribute("ruleId", finding.check);
+        json.attribute("level", "warning");
+        json.attributeObject("message", [&] { json.attribute("text", finding.message); });
+        json.attributeArray("locations", [&] {
+            json.object([&] {
+                if (!file.empty()) {
+                    json.attributeObject("physicalLocation", [&] {
+                        json.attributeObject("artifactLocation", [&] { json.attribute("uri", fileURI(file)); });
+                        json.attributeObject("region", [&] {
+                            json.attribute("startLine", line);
+                            json.attribute("startColumn", column);
+                        });
+                    });
+                }
+                if (!finding.function.empty()) {
+                    json.attributeArray("logicalLocations", [&] {
+                        json.object([&] {
+                            json.attribute("fullyQualifiedName", finding.function);
+                            json.attribute("kind", "function");
+                        });
+                    });
+                }
+            });
+        });
+    });
+}
+
+void FindingWriter::write(llvm::StringRef batch) {
+    if (batch.empty()) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (empty && format == OutputFormat::SARIF) batch.consume_front(sarifSeparator);
+    os << batch;
+    empty = false;
+}
+
+void FindingWriter::finish() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (format == OutputFormat::SARIF) os << "\n]}]}\n";
+    os.flush();
+}
+
+std::string expandMessage(const Finding& finding, const clang::SourceManager& sm) {
+    if (finding.related.isInvalid()) return finding.message;
+    std::string message = finding.message;
+    auto replace = [&message](llvm::StringRef placeholder, const std::string& value) {
+        for (size_t at = message.find(placeholder); at != std::string::npos; at = message.find(placeholder, at + value.size()))
+            message.replace(at, placeholder.size(), value);
+    };
+    replace("{related-file}", sm.getFilename(finding.related).str());
+    replace("{related-line}", std::to_string(sm.getSpellingLineNumber(finding.related)));
+    return message;
+}
+
+void DiagnosticEmitter::setDiagnostics(clang::DiagnosticsEngine* engine) {
+    flush();
+    this->engine = engine;
+    diagIDs.clear();
+}
+
+ResolvedFinding DiagnosticEmitter::resolve(Finding finding) const {
+    ResolvedFinding resolved{std::move(finding.check), "", 0, 0, std::move(finding.message),
+                             std::move(finding.function), sharedFunction};
+    const clang::SourceManager& sm = engine->getSourceManager();
+    clang::PresumedLoc presumed;
+    if (finding.loc.isValid()) presumed = sm.getPresumedLoc(sm.getFileLoc(finding.loc));
+    if (presumed.isValid()) {
+        resolved.file = presumed.getFilename();
+        resolved.line = presumed.getLine();
+        resolved.column = presumed.getColumn();
+    }
+    return resolved;
+}
+
+void DiagnosticEmitter::report(Finding finding) {
+    if (!engine) return;
+    if (finding.related.isValid()) finding.message = expandMessage(finding, engine->getSourceManager());
+
+    if (writer) {
+        ResolvedFinding resolved = resolve(std::move(finding));
+        writer->formatRecord(batch, resolved);
+        if (recorded) recorded->push_back(std::move(resolved));
+        if (batch.size() >= maxBatchSize) flush();
+        return;
+    }
+    if (recorded) recorded->push_back(resolve(finding));
+
+    auto [it, inserted] = diagIDs.try_emplace(finding.check, 0);
+    if (inserted) {
+        // The engine only takes string literals, the check name is part of the format here
+        it->second = engine->getDiagnosticIDs()->getCustomDiagID(clang::DiagnosticIDs::Warning,
+                                                                 std::format("%0 [{}]", finding.check));
+    }
+    engine->Report(finding.loc, it->second) << finding.message;
+}
+
+void DiagnosticEmitter::flush() {
+    if (!writer || batch.empty()) return;
+    writer->write(batch);
+    batch.clear();
+}
+
+} // namespace myproject
@@ -0,0 +1,111 @@
+#ifndef FINDINGS_H
+#define FINDINGS_H
+
+#include <clang/Basic/Diagnostic.h>
+#include <clang/Basic/SourceLocation.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/raw_ostream.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace myproject {
+
+// One result of a check. Checks never talk to the DiagnosticsEngine directly, so findings can be
+// buffered (parallel analysis) and emitted later on the thread that owns the engine.
+struct Finding {
+    std::string check;       // CheckStrategy::getName()
+    clang::SourceLocation loc;
+    std::string message;     // Fully formatted message, apart from the placeholders of `related`
+    std::string function;    // Qualified name of the enclosing function, empty if unknown
+    // Another location the message mentions, e.g. an enclosing loop. Checks may run on worker threads that
+    // must not use the SourceManager, so "{related-file}" and "{related-line}" in the message are only
+    // replaced by its file name and line when the finding is emitted, see expandMessage().
+    clang::SourceLocation related;
+};
+
+// The message of `finding` with the placeholders of its related location filled in
+std::string expandMessage(const Finding& finding, const clang::SourceManager& sm);
+
+// A finding with its location resolved to file, line and column, independent of the TU it came from
+struct ResolvedFinding {
+    std::string check;
+    std::string file;        // Empty if the location is unknown
+    unsigned line = 0;
+    unsigned column = 0;
+    std::string message;
+    std::string function;
+    std::string sharedFunction; // AnalyzedFunctions key of the header function it was found in, empty otherwise
+};
+
+class FindingSink {
+public:
+    virtual ~FindingSink() = default;
+    virtual void report(Finding finding) = 0;
+};
+
+// Keeps findings in the order they were reported
+class FindingBuffer : public FindingSink {
+public:
+    void report(Finding finding) override { findings.push_back(std::move(finding)); }
+    const std::vector<Finding>& getFindings() const { return findings; }
+private:
+    std::vector<Finding> findings;
+};
+
+enum class OutputFormat {
+    Text,  // Clang warnings on stderr
+    JSONL, // One JSON object per finding and line
+    SARIF  // A SARIF 2.1.0 log with one run
+};
+
+// Streams findings as structured records to one output shared by every worker. Records arrive in
+// batches (one or more TUs worth of findings), so the lock is taken once per batch, not per finding.
+class FindingWriter {
+public:
+    // `checks` become the rules of the SARIF run, the SARIF header is written right away
+    FindingWriter(OutputFormat format, llvm::raw_ostream& os, const std::vector<std::string>& checks);
+
+    OutputFormat getFormat() const { return format; }
+
+    // Append the record of one finding to `batch`
+    void formatRecord(std::string& batch, const ResolvedFinding& finding) const;
+    // Write a batch built by formatRecord, thread-safe
+    void write(llvm::StringRef batch);
+    // Write the SARIF trailer and flush, no records may follow
+    void finish();
+private:
+    OutputFormat format;
+    llvm::raw_ostream& os;
+    std::mutex mutex;
+    bool empty = true; // Nothing written yet, the first SARIF record has no separator
+};
+
+// Reports the findings of the current TU: as warnings of its DiagnosticsEngine, or as records of a
+// FindingWriter when one is set
+class DiagnosticEmitter : public FindingSink {
+public:
+    // Called at the start of each TU, every CompilerInstance has its own engine. Passing nullptr at
+    // the end of a TU hands the remaining records to the writer.
+    void setDiagnostics(clang::DiagnosticsEngine* engine);
+    void setWriter(FindingWriter* writer) { this->writer = writer; }
+    // Also keep a resolved copy of every finding in `recorded` (nullptr to stop), used by the ResultCache
+    void setRecording(std::vector<ResolvedFinding>* recorded) { this->recorded = recorded; }
+    // Tag the following findings with this AnalyzedFunctions key, empty for none
+    void setSharedFunction(std::string key) { sharedFunction = std::move(key); }
+    void report(Finding finding) override;
+private:
+    ResolvedFinding resolve(Finding finding) const;
+    void flush();
+
+    clang::DiagnosticsEngine* engine = nullptr;
+    llvm::StringMap<unsigned> diagIDs; // Check -> its warning, registered once per check and TU
+    FindingWriter* writer = nullptr;
+    std::string batch;                 // Records not handed to the writer yet
+    std::vector<ResolvedFinding>* recorded = nullptr;
+    std::string sharedFunction;
+};
+
+} // namespace myproject
+
+#endif // FINDINGS_H
@@ -0,0 +1,23 @@
+#include "FrontendAction.h"
+
+namespace myproject {
+
+bool MyASTConsumer::shouldSkipFunctionBody(clang::Decl* D) {
+    clang::SourceLocation loc = sm.getExpansionLoc(D->getLocation());
+    if (loc.isInvalid()) return false;
+
+    clang::FileID fid = sm.getFileID(loc);
+    auto [it, inserted] = skipFile.try_emplace(fid, false);
+    if (inserted) it->second = !callback->isInTraversalScope(sm, fid);
+    return it->second;
+}
+
+std::unique_ptr<clang::ASTConsumer> MyFrontendAction::CreateASTConsumer(clang::CompilerInstance& CI, llvm::StringRef file) {
+    // Same mechanism as -skip-function-bodies, but our consumer decides which bodies can go.
+    // Sema still keeps bodies it needs (constexpr functions, deduced return types).
+    if (skipHeaderBodies) CI.getFrontendOpts().SkipFunctionBodies = true;
+    matchCallback->beginTranslationUnit();
+    return std::make_unique<MyASTConsumer>(matchCallback, CI.getSourceManager());
+}
+
+} // namespace myproject
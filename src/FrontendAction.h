@@ -0,0 +1,66 @@
+#ifndef FRONTEND_ACTION_H
+#define FRONTEND_ACTION_H
+
+#include <clang/AST/ASTConsumer.h>
+#include <clang/Basic/SourceManager.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendAction.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/DenseMap.h>
+#include <memory>
+#include "MatchCallback.h"
+
+namespace myproject {
+
+class MyASTConsumer : public clang::ASTConsumer {
+public:
+    MyASTConsumer(MyMatchCallback* callback, const clang::SourceManager& sm) : callback(callback), sm(sm) {}
+
+    // After the AST has been parsed completely, the HandleTranslationUnit method is called.
+    // The consumer is created right before parsing starts, so its age is the parse time.
+    void HandleTranslationUnit(clang::ASTContext& context) override {
+        callback->recordPhase("parse", parseWatch.seconds());
+        callback->matchAST(context);
+    }
+
+    // Only asked by Sema when function body skipping is enabled. Bodies of the main file (and of the
+    // traversal scope files) are always parsed, so the checks see exactly the same functions as before.
+    bool shouldSkipFunctionBody(clang::Decl* D) override;
+
+private:
+    MyMatchCallback* callback;
+    const clang::SourceManager& sm;
+    llvm::DenseMap<clang::FileID, bool> skipFile; // Answer per file, a header has many bodies
+    Stopwatch parseWatch;
+};
+
+// Custom FrontendAction. The checks and the MatchFinder are built once up front and shared by every TU
+class MyFrontendAction : public clang::ASTFrontendAction {
+public:
+    MyFrontendAction(MyMatchCallback* matchCallback, bool skipHeaderBodies)
+        : matchCallback(matchCallback), skipHeaderBodies(skipHeaderBodies) {}
+
+    std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(clang::CompilerInstance& CI, llvm::StringRef file) override;
+
+private:
+    MyMatchCallback* matchCallback;
+    bool skipHeaderBodies;
+};
+
+class MyFrontendActionFactory : public clang::tooling::FrontendActionFactory {
+public:
+    MyFrontendActionFactory(MyMatchCallback* matchCallback, bool skipHeaderBodies)
+        : matchCallback(matchCallback), skipHeaderBodies(skipHeaderBodies) {}
+
+    std::unique_ptr<clang::FrontendAction> create() override {
+        return std::make_unique<MyFrontendAction>(matchCallback, skipHeaderBodies);
+    }
+
+private:
+    MyMatchCallback* matchCallback;
+    bool skipHeaderBodies;
+};
+
+} // namespace myproject
+
+#endif // FRONTEND_ACTION_H
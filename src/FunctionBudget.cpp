@@ -0,0 +1,26 @@
+#include "FunctionBudget.h"
+#include <format>
+
+namespace myproject {
+
+void FunctionBudget::skip(Skipped function) {
+    std::lock_guard<std::mutex> lock(mutex);
+    skipped.push_back(std::move(function));
+}
+
+size_t FunctionBudget::getSkippedCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return skipped.size();
+}
+
+void FunctionBudget::printSummary(llvm::raw_ostream& os, size_t max) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (skipped.empty()) return;
+
+    os << std::format("warning: {} functions exceeded the analysis budget and were not (fully) analyzed:\n", skipped.size());
+    for (size_t i = 0; i < skipped.size() && i < max; ++i)
+        os << std::format("  {}: {} ({})\n", skipped[i].location, skipped[i].function, skipped[i].reason);
+    if (skipped.size() > max) os << std::format("  ... and {} more\n", skipped.size() - max);
+}
+
+} // namespace myproject
@@ -0,0 +1,73 @@
+#ifndef FUNCTION_BUDGET_H
+#define FUNCTION_BUDGET_H
+
+#include <llvm/Support/raw_ostream.h>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace myproject {
+
+// Time limit of one check on one function. Checks poll expired() in their long-running loops and give
+// up on the function when it returns true; their findings for it are then dropped.
+class Deadline {
+public:
+    Deadline() = default; // Never expires
+    explicit Deadline(double seconds)
+        : end(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                      std::chrono::duration<double>(seconds))),
+          limited(true) {}
+
+    // Cheap enough for inner loops, the clock is only read every 64 calls
+    bool expired() {
+        if (!limited || hit) return hit;
+        if (++polls % 64) return false;
+        hit = std::chrono::steady_clock::now() >= end;
+        return hit;
+    }
+    bool wasExpired() const { return hit; }
+
+private:
+    std::chrono::steady_clock::time_point end;
+    bool limited = false;
+    bool hit = false;
+    unsigned polls = 0;
+};
+
+// Per-function limits (--max-cfg-blocks, --max-ast-nodes, --max-function-seconds), 0 means no limit
+struct BudgetLimits {
+    unsigned maxCFGBlocks = 0;
+    unsigned maxASTNodes = 0;
+    double maxSeconds = 0;
+};
+
+// The limits plus the functions that exceeded them, shared by every worker
+class FunctionBudget {
+public:
+    struct Skipped {
+        std::string location; // file:line of the function
+        std::string function; // Qualified name
+        std::string reason;   // Which limit, e.g. "4711 CFG blocks"
+    };
+
+    explicit FunctionBudget(BudgetLimits limits) : limits(limits) {}
+    const BudgetLimits& getLimits() const { return limits; }
+
+    // Thread-safe
+    void skip(Skipped skipped);
+    size_t getSkippedCount() const;
+
+    // The skipped functions, at most `max` of them listed, nothing if none was skipped
+    void printSummary(llvm::raw_ostream& os, size_t max) const;
+
+private:
+    BudgetLimits limits;
+    mutable std::mutex mutex;
+    std::vector<Skipped> skipped;
+};
+
+} // namespace myproject
+
+#endif // FUNCTION_BUDGET_H
@@ -0,0 +1,63 @@
+#include "FunctionMemo.h"
+#include <clang/AST/DeclCXX.h>
+#include <clang/AST/Expr.h>
+#include <clang/AST/ODRHash.h>
+#include <clang/Index/USRGeneration.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/xxhash.h>
+#include <algorithm>
+#include <format>
+
+namespace myproject {
+
+// The ODR hash only names the declarations a body refers to. Add what the CFG and the checks depend on,
+// so changing e.g. a global from int to const int or a constant's value invalidates the entry.
+static void describeReferences(const clang::FunctionDecl* FD, const clang::Stmt* S, std::string& out) {
+    if (!S) return;
+    const clang::ValueDecl* D = nullptr;
+    if (const auto* DRE = llvm::dyn_cast<clang::DeclRefExpr>(S))
+        D = DRE->getDecl();
+    else if (const auto* ME = llvm::dyn_cast<clang::MemberExpr>(S))
+        D = ME->getMemberDecl();
+
+    if (D && !static_cast<const clang::DeclContext*>(FD)->Encloses(D->getDeclContext())) {
+        out += D->getType().getCanonicalType().getAsString();
+        if (const auto* callee = llvm::dyn_cast<clang::FunctionDecl>(D)) {
+            out += callee->isNoReturn() ? "!" : "";
+        } else if (const auto* VD = llvm::dyn_cast<clang::VarDecl>(D)) {
+            // Conditions on constants are folded while building the CFG
+            const clang::VarDecl* definition = nullptr;
+            const clang::Expr* init = VD->getType().isConstQualified() ? VD->getAnyInitializer(definition) : nullptr;
+            if (init) {
+                clang::ODRHash hash;
+                hash.AddStmt(init);
+                out += std::format("={:x}", hash.CalculateHash());
+            }
+        }
+        out += ";";
+    }
+    for (const clang::Stmt* child : S->children()) describeReferences(FD, child, out);
+}
+
+std::optional<std::string> FunctionMemo::key(const clang::FunctionDecl* FD) {
+    const clang::FunctionDecl* definition = FD->getDefinition();
+    if (!definition || !definition->getBody()) return std::nullopt;
+
+    llvm::SmallString<128> usr;
+    if (clang::index::generateUSRForDecl(definition, usr)) return std::nullopt;
+
+    clang::ODRHash hash;
+    hash.AddFunctionDecl(definition);
+    std::string references;
+    describeReferences(definition, definition->getBody(), references);
+    return std::format("{}#{:08x}-{:016x}", usr.str().str(), hash.CalculateHash(), llvm::xxHash64(references));
+}
+
+const MemoEntry* FunctionMemo::find(llvm::StringRef key, llvm::StringRef check) const {
+    auto it = functions.find(key);
+    if (it == functions.end()) return nullptr;
+    const auto& checks = it->second.checks;
+    return std::find(checks.begin(), checks.end(), check) != checks.end() ? &it->second : nullptr;
+}
+
+} // namespace myproject
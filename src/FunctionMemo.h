@@ -0,0 +1,48 @@
+#ifndef FUNCTION_MEMO_H
+#define FUNCTION_MEMO_H
+
+#include <clang/AST/Decl.h>
+#include <llvm/ADT/StringMap.h>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace myproject {
+
+// A finding of a memoized function. The line is relative to the first line of the function, so the
+// finding stays valid when code above the function is edited.
+struct MemoFinding {
+    std::string check;
+    unsigned line = 0;
+    unsigned column = 0;
+    std::string message; // Placeholders of the related location not filled in, see Finding
+    bool hasRelated = false;
+    unsigned relatedLine = 0; // Relative like `line`
+    unsigned relatedColumn = 0;
+};
+
+// What the checks found in one version of a function
+struct MemoEntry {
+    std::vector<std::string> checks; // Checks that ran, with or without findings
+    std::vector<MemoFinding> findings;
+};
+
+// Findings of the functions of one main file, kept by the ResultCache from one run to the next. A TU
+// that changed is analyzed again, but only the functions whose key changed need their CFG.
+class FunctionMemo {
+public:
+    // Structural hash of FD: the USR, the ODR hash of the definition (statement structure and names, no
+    // locations) and what the checks see of the declarations it references from outside, like their
+    // types, [[noreturn]] and the initializers of constants. std::nullopt when FD cannot be memoized.
+    // MyMatchCallback adds the column and a hash of the function's text, which the ODR hash does not see.
+    static std::optional<std::string> key(const clang::FunctionDecl* FD);
+
+    // The entry of `key` if `check` ran on it
+    const MemoEntry* find(llvm::StringRef key, llvm::StringRef check) const;
+
+    llvm::StringMap<MemoEntry> functions;
+};
+
+} // namespace myproject
+
+#endif // FUNCTION_MEMO_H
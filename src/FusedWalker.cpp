@@ -0,0 +1,76 @@
+#include "FusedWalker.h"
+#include <optional>
+
+namespace myproject {
+
+namespace cam = clang::ast_matchers;
+
+// A match that binds FD to `binding`, like the check's function matcher would have produced
+static cam::MatchFinder::MatchResult functionMatch(llvm::StringRef binding, const clang::FunctionDecl* FD, clang::ASTContext& context) {
+    // The checks read their function from result.Nodes, so this has to be a real BoundNodes. Its constructor
+    // is private to the matcher internals: BoundNodesTreeBuilder is the only way to make one outside of a
+    // MatchFinder, and it hands them out through a visitor. It lives in ast_matchers::internal and may change
+    // with the clang version.
+    struct Collect : cam::internal::BoundNodesTreeBuilder::Visitor {
+        void visitMatch(const cam::BoundNodes& bound) override { nodes.emplace(bound); }
+        std::optional<cam::BoundNodes> nodes;
+    };
+    cam::internal::BoundNodesTreeBuilder builder;
+    builder.setBinding(binding.str(), clang::DynTypedNode::create(*FD));
+    Collect collect;
+    builder.visitMatches(&collect);
+    return cam::MatchFinder::MatchResult(*collect.nodes, &context);
+}
+
+void FusedWalker::walk(clang::ASTContext& context, Dispatch dispatch) {
+    this->context = &context;
+    // Follows the traversal scope of the context
+    TraverseAST(context);
+
+    // Whether a function is wanted is only known once its body was walked, the matches are sent afterwards
+    // so that an enclosing function still comes before the functions nested in it
+    for (const Frame& frame : functions) {
+        for (unsigned i = 0; i < checks.size(); ++i) {
+            if (!frame.wanted[i]) continue;
+            dispatch(*checks[i], functionMatch(checks[i]->getFunctionVisitor()->getFunctionBinding(), frame.function, context));
+        }
+    }
+    functions.clear();
+    this->context = nullptr;
+}
+
+bool FusedWalker::TraverseDecl(clang::Decl* D) {
+    const auto* FD = llvm::dyn_cast_or_null<clang::FunctionDecl>(D);
+    if (!FD || !FD->doesThisDeclarationHaveABody()) return RecursiveASTVisitor::TraverseDecl(D);
+
+    const clang::SourceManager& sm = context->getSourceManager();
+    Frame frame{FD, {}, {}};
+    frame.wanted.resize(checks.size());
+    for (unsigned i = 0; i < checks.size(); ++i) {
+        switch (checks[i]->getFunctionVisitor()->interest(FD, sm)) {
+        case FunctionVisitor::Interest::No: break;
+        case FunctionVisitor::Interest::Yes: frame.wanted[i] = true; break;
+        case FunctionVisitor::Interest::IfAnyStmt: frame.waiting.push_back(i); break;
+        }
+    }
+    frames.push_back(static_cast<unsigned>(functions.size()));
+    functions.push_back(std::move(frame));
+    bool result = RecursiveASTVisitor::TraverseDecl(D);
+    frames.pop_back();
+    return result;
+}
+
+bool FusedWalker::VisitStmt(clang::Stmt* S) {
+    for (unsigned index : frames) {
+        Frame& frame = functions[index];
+        if (frame.waiting.empty()) continue;
+        llvm::erase_if(frame.waiting, [&](unsigned i) {
+            if (!checks[i]->getFunctionVisitor()->matchesStmt(S)) return false;
+            frame.wanted[i] = true;
+            return true;
+        });
+    }
+    return true;
+}
+
+} // namespace myproject
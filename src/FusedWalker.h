@@ -0,0 +1,50 @@
+#ifndef FUSED_WALKER_H
+#define FUSED_WALKER_H
+
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/RecursiveASTVisitor.h>
+#include <clang/ASTMatchers/ASTMatchFinder.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+#include <vector>
+#include "CheckStrategies.h"
+
+namespace myproject {
+
+// Walks the traversal scope of a TU once for every check that has a FunctionVisitor. Each function definition
+// is offered to all of them, the statements of its body are fanned out in the same walk to the checks that
+// wait for one. Once the whole scope has been walked, the checks that want a function get a match binding it:
+// functions in pre-order and checks in check order, the order MatchFinder reports the same matches in.
+// Statements of nested functions (local classes, lambdas) count for the enclosing functions too, like
+// hasDescendant() does.
+class FusedWalker : public clang::RecursiveASTVisitor<FusedWalker> {
+public:
+    using Dispatch = llvm::function_ref<void(CheckStrategy&, const clang::ast_matchers::MatchFinder::MatchResult&)>;
+
+    // With TK_AsIs template instantiations and implicit code are walked as well, like the matchers would
+    FusedWalker(const std::vector<CheckStrategy*>& checks, clang::TraversalKind kind) : checks(checks), asIs(kind == clang::TK_AsIs) {}
+
+    void walk(clang::ASTContext& context, Dispatch dispatch);
+
+    bool shouldVisitTemplateInstantiations() const { return asIs; }
+    bool shouldVisitImplicitCode() const { return asIs; }
+    bool TraverseDecl(clang::Decl* D);
+    bool VisitStmt(clang::Stmt* S);
+
+private:
+    struct Frame {
+        const clang::FunctionDecl* function;
+        llvm::SmallVector<bool, 8> wanted;      // Per check
+        llvm::SmallVector<unsigned, 8> waiting; // Checks still looking for a statement
+    };
+
+    const std::vector<CheckStrategy*>& checks;
+    bool asIs;
+    clang::ASTContext* context = nullptr;
+    std::vector<Frame> functions;  // Every function walked, in pre-order
+    std::vector<unsigned> frames;  // Indices into `functions` of the ones being walked, innermost last
+};
+
+} // namespace myproject
+
+#endif // FUSED_WALKER_H
@@ -0,0 +1,16 @@
+#include "Log.h"
+#include <llvm/Support/raw_ostream.h>
+#include <mutex>
+
+namespace myproject {
+
+std::atomic<LogLevel> Log::current{LogLevel::Info};
+llvm::raw_ostream* Log::stream = &llvm::outs();
+
+void Log::write(llvm::StringRef message) {
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    *stream << message << "\n";
+}
+
+} // namespace myproject
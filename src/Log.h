@@ -0,0 +1,54 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/raw_ostream.h>
+#include <atomic>
+#include <format>
+
+namespace myproject {
+
+// Verbosity of the progress and debug output, every level includes the ones before it
+enum class LogLevel {
+    Quiet,  // Nothing but diagnostics
+    Info,   // Setup messages such as the enabled checks
+    Debug,  // Unexpected situations inside the checks
+    Trace   // Per-function and per-loop output of the checks, see MYPROJECT_TRACE
+};
+
+// Process-wide log on llvm::outs(), kept apart from the diagnostics on llvm::errs(). Every message is
+// written as one line under a lock, so lines of parallel workers never get mixed up.
+class Log {
+public:
+    static void setLevel(LogLevel level) { current.store(level, std::memory_order_relaxed); }
+    // Log somewhere else, e.g. when stdout carries the structured findings. Set before any worker starts
+    static void setStream(llvm::raw_ostream& os) { stream = &os; }
+    static bool isEnabled(LogLevel level) { return level != LogLevel::Quiet && level <= current.load(std::memory_order_relaxed); }
+    static void write(llvm::StringRef message);
+
+private:
+    static std::atomic<LogLevel> current;
+    static llvm::raw_ostream* stream;
+};
+
+} // namespace myproject
+
+// Formats (with std::format) and writes the message only when `level` is enabled
+#define MYPROJECT_LOG(level, ...)                                                   \
+    do {                                                                            \
+        if (::myproject::Log::isEnabled(level))                                     \
+            ::myproject::Log::write(std::format(__VA_ARGS__));                      \
+    } while (0)
+
+// Trace output of the analysis hot paths. Building with MYPROJECT_ENABLE_TRACE=0 removes these calls
+// and their arguments entirely; otherwise they cost one check of the level unless --verbosity=trace.
+#ifndef MYPROJECT_ENABLE_TRACE
+#define MYPROJECT_ENABLE_TRACE 1
+#endif
+#if MYPROJECT_ENABLE_TRACE
+#define MYPROJECT_TRACE(...) MYPROJECT_LOG(::myproject::LogLevel::Trace, __VA_ARGS__)
+#else
+#define MYPROJECT_TRACE(...) do {} while (0)
+#endif
+
+#endif // LOG_H
@@ -1,79 +1,295 @@
 #pragma once
 
 #include "CheckStrategies.h"
-#include <set>
-
-bool isComparisonOperator(const clang::BinaryOperator* BO) {
-    static const std::set<clang::BinaryOperatorKind> comparisonOps = {
-        clang::BO_EQ, clang::BO_NE, clang::BO_LT, 
-        clang::BO_GT, clang::BO_LE, clang::BO_GE
-    };
-    return comparisonOps.find(BO->getOpcode()) != comparisonOps.end();
-}
-
-class LoopInvariantCheck : public CheckStrategy {
+#include "CheckRegistry.h"
+#include "BlockReachability.h"
+#include <clang/Analysis/CFG.h>
+#include <clang/Analysis/Analyses/Dominators.h>
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <algorithm>
+#include <numeric>
+
+class LoopInvariantCheck : public CheckStrategy, public myproject::FunctionVisitor {
 public:
 
 LoopInvariantCheck(const std::string& name) : CheckStrategy(name) {}
 MatchersList getMatchers() const final {
     using namespace clang::ast_matchers;
-    using cadv = clang::ast_matchers::dynamic::VariantMatcher;
     
+    // The loops of a function are analyzed together, so match the functions that have any
     MatchersList matchers;
-    matchers.push_back(cadv::SingleMatcher(stmt(anyOf(forStmt(), whileStmt(), doStmt())).bind("loop_invariant")));
+    matchers.declarations.push_back(functionDecl(hasBody(stmt(hasDescendant(
+        stmt(anyOf(forStmt(), whileStmt(), doStmt())))))).bind("loop_invariant"));
     
     return matchers;
 }
-std::optional<bool> check(const clang::ast_matchers::MatchFinder::MatchResult& result) final;
+std::optional<bool> check(const clang::ast_matchers::MatchFinder::MatchResult& result, myproject::CheckContext& context) final;
+
+// Only reads the function's own CFG, the loop nest is local to check()
+const clang::FunctionDecl* analyzedFunction(const clang::ast_matchers::MatchFinder::MatchResult& result) const final {
+    return result.Nodes.getNodeAs<clang::FunctionDecl>("loop_invariant");
+}
+
+// Functions with a for/while/do loop anywhere in their body, like hasDescendant() in the matcher
+const myproject::FunctionVisitor* getFunctionVisitor() const final { return this; }
+llvm::StringRef getFunctionBinding() const final { return "loop_invariant"; }
+Interest interest(const clang::FunctionDecl*, const clang::SourceManager&) const final { return Interest::IfAnyStmt; }
+bool matchesStmt(const clang::Stmt* S) const final {
+    return llvm::isa<clang::ForStmt>(S) || llvm::isa<clang::WhileStmt>(S) || llvm::isa<clang::DoStmt>(S);
+}
+
+// Variables that may be written while the loop runs
+using ModifiedSet = llvm::SmallPtrSet<const clang::VarDecl*, 16>;
+
+// A natural loop of the function CFG
+struct Loop {
+    const clang::CFGBlock *header;
+    llvm::BitVector blocks;             // IDs of the blocks in the loop, nested loops included
+    const clang::Stmt *stmt = nullptr;  // The for/while/do statement, null for loops made with goto
+    int parent = -1;                    // Index of the innermost enclosing loop
+    ModifiedSet modified;               // Variables written anywhere in the loop
+};
 
 private:
-void analyzeStmt(const clang::Stmt *S, const clang::ast_matchers::MatchFinder::MatchResult &result);
-bool isLoopInvariant(const clang::Stmt *E, const clang::Stmt *LoopBody, const clang::ast_matchers::MatchFinder::MatchResult &result);
-bool isModifiedInLoop(const clang::VarDecl *VD, const clang::Stmt *LoopBody, const clang::ast_matchers::MatchFinder::MatchResult &result);
-std::optional<bool> reportLoopInvariant(const clang::Stmt *S, const clang::ast_matchers::MatchFinder::MatchResult &result) const;
-bool isRightOperandInvariant(const clang::Expr *RHS, const clang::Stmt *LoopBody, const clang::ast_matchers::MatchFinder::MatchResult &result);
+std::vector<Loop> buildLoopNest(const clang::CFG &cfg, myproject::Arena *arena) const;
+void noteModification(const clang::Stmt *S, ModifiedSet &modified) const;
+void analyzeStmt(const clang::Stmt *S, const std::vector<Loop> &loops, unsigned index, const clang::ast_matchers::MatchFinder::MatchResult &result,
+                 myproject::FindingSink &findings, const clang::FunctionDecl *FD, myproject::Deadline &deadline);
+bool isLoopInvariant(const clang::Stmt *E, const ModifiedSet &modified, const clang::ast_matchers::MatchFinder::MatchResult &result);
+std::optional<bool> reportLoopInvariant(const clang::Stmt *S, const clang::Stmt *Outermost, const clang::ast_matchers::MatchFinder::MatchResult &result,
+                                        myproject::FindingSink &findings, const clang::FunctionDecl *FD) const;
+bool isRightOperandInvariant(const clang::Expr *RHS, const ModifiedSet &modified);
 };
 
-std::optional<bool> LoopInvariantCheck::check(const clang::ast_matchers::MatchFinder::MatchResult &result) {
-    if (const clang::Stmt *S = result.Nodes.getNodeAs<clang::Stmt>("loop_invariant")) {
+inline const myproject::RegisterCheck<LoopInvariantCheck> registerLoopInvariantCheck("loop-invariant");
+
+std::optional<bool> LoopInvariantCheck::check(const clang::ast_matchers::MatchFinder::MatchResult &result, myproject::CheckContext& context) {
+    const auto *FD = result.Nodes.getNodeAs<clang::FunctionDecl>("loop_invariant");
+    if (!FD || !FD->hasBody()) return std::nullopt;
+
+    clang::AnalysisDeclContext *AC = context.cache.getContext(FD, *result.Context);
+    const clang::CFG *cfg = AC ? AC->getCFG() : nullptr;
+    if (!cfg) {
+        llvm::errs() << "Could not generate CFG for function.\n";
+        return false;
+    }
+
+    // The loop nest and the modification summaries are built once for the whole function
+    std::vector<Loop> loops = buildLoopNest(*cfg, context.arena);
+
+    // Visit the for/while/do loops in source order, outer loops before the loops they contain. That is the order
+    // of a pre-order walk of the body, which needs no SourceManager (check() may run on a worker thread).
+    llvm::DenseMap<const clang::Stmt*, unsigned> byStmt;
+    for (unsigned i = 0; i < loops.size(); ++i) {
+        if (loops[i].stmt) byStmt.try_emplace(loops[i].stmt, i);
+    }
+    myproject::ArenaVector<unsigned> order(context.arena);
+    myproject::ArenaVector<const clang::Stmt*> stack(context.arena);
+    stack.push_back(FD->getBody());
+    while (!stack.empty() && order.size() < byStmt.size()) {
+        const clang::Stmt *S = stack.back();
+        stack.pop_back();
+        if (!S) continue;
+        if (auto it = byStmt.find(S); it != byStmt.end()) order.push_back(it->second);
+        size_t first = stack.size();
+        for (const clang::Stmt *Child : S->children()) stack.push_back(Child);
+        std::reverse(stack.begin() + first, stack.end());
+    }
+
+    for (unsigned index : order) {
+        if (context.deadline.expired()) return false;
+        const clang::Stmt *S = loops[index].stmt;
 
         // Define a lambda to process the loop body
-        auto processBody = [this, &result](const clang::Stmt *Body) {
+        auto processBody = [&, index](const clang::Stmt *Body) {
             if (Body) {
-                analyzeStmt(Body, result);  // Main analysis function
+                analyzeStmt(Body, loops, index, result, context.findings, FD, context.deadline);  // Main analysis function
             } else {
-                llvm::outs() << "Loop body is null\n";  
+                MYPROJECT_LOG(myproject::LogLevel::Debug, "Loop body is null");
             }
         };
 
         if (const clang::ForStmt* ForLoop = llvm::dyn_cast<clang::ForStmt>(S)) {
-            llvm::outs() << "Found a for loop\n";
+            MYPROJECT_TRACE("Found a for loop");
             processBody(ForLoop->getBody());  
         } else if (const clang::WhileStmt* WhileLoop = llvm::dyn_cast<clang::WhileStmt>(S)) {
-            llvm::outs() << "Found a while loop\n";
+            MYPROJECT_TRACE("Found a while loop");
             processBody(WhileLoop->getBody());  
         } else if (const clang::DoStmt* DoLoop = llvm::dyn_cast<clang::DoStmt>(S)) {
-            llvm::outs() << "Found a do-while loop\n";
+            MYPROJECT_TRACE("Found a do-while loop");
             processBody(DoLoop->getBody());  
-        } else {
-            llvm::outs() << "No loop found\n";
-            return false;
         }
-        return true;
     }
-    return std::nullopt;
+    return !context.deadline.wasExpired();
 }
 
+// Natural loops from the dominator tree: an edge B -> H where H dominates B is a back edge, and the loop
+// is H plus every block that reaches B without going through H. The parent of a loop is the smallest other
+// loop containing its header. Modifications are collected per block into the innermost loop and then merged
+// bottom-up, so every CFG element is looked at once.
+std::vector<LoopInvariantCheck::Loop> LoopInvariantCheck::buildLoopNest(const clang::CFG &cfg, myproject::Arena *arena) const {
+    unsigned numBlocks = cfg.getNumBlockIDs();
+    myproject::ArenaVector<const clang::CFGBlock*> blocks(numBlocks, nullptr, arena);
+    for (const clang::CFGBlock *B : cfg) blocks[B->getBlockID()] = B;
+
+    // The dominator tree considers unreachable blocks dominated by everything, leave them out. The engine
+    // keeps its bitvectors between functions, like the one of UnreachableCodeCheck.
+    static thread_local myproject::BlockReachability reachability;
+    reachability.compute(cfg);
+    myproject::ArenaVector<const clang::CFGBlock*> worklist(arena);
+
+    clang::CFGDomTree domTree(const_cast<clang::CFG*>(&cfg));
+
+    // Back edges to the same header form one loop
+    std::vector<Loop> loops;
+    llvm::DenseMap<const clang::CFGBlock*, unsigned> byHeader;
+    for (const clang::CFGBlock *B : cfg) {
+        if (!reachability.isReachable(B->getBlockID())) continue;
+        for (const clang::CFGBlock *Header : B->succs()) {
+            if (!Header || !domTree.dominates(Header, B)) continue;
+
+            auto [it, inserted] = byHeader.try_emplace(Header, static_cast<unsigned>(loops.size()));
+            if (inserted) loops.push_back({Header, llvm::BitVector(numBlocks)});
+            Loop &loop = loops[it->second];
+            // The CFG builder marks the block jumping back with the loop statement
+            if (!loop.stmt) loop.stmt = B->getLoopTarget();
+            loop.blocks.set(Header->getBlockID());
+            if (loop.blocks.test(B->getBlockID())) continue;
+
+            loop.blocks.set(B->getBlockID());
+            worklist.push_back(B);
+            while (!worklist.empty()) {
+                const clang::CFGBlock *Block = worklist.back();
+                worklist.pop_back();
+                for (const clang::CFGBlock *Pred : Block->preds()) {
+                    if (Pred && reachability.isReachable(Pred->getBlockID()) && !loop.blocks.test(Pred->getBlockID())) {
+                        loop.blocks.set(Pred->getBlockID());
+                        worklist.push_back(Pred);
+                    }
+                }
+            }
+        }
+    }
 
+    // Inner loops are strictly smaller than the loops containing them
+    myproject::ArenaVector<unsigned> bySize(loops.size(), arena);
+    std::iota(bySize.begin(), bySize.end(), 0u);
+    std::stable_sort(bySize.begin(), bySize.end(), [&loops](unsigned a, unsigned b) {
+        return loops[a].blocks.count() < loops[b].blocks.count();
+    });
+    for (unsigned i = 0; i < bySize.size(); ++i) {
+        Loop &inner = loops[bySize[i]];
+        for (unsigned j = i + 1; j < bySize.size(); ++j) {
+            if (loops[bySize[j]].blocks.test(inner.header->getBlockID())) {
+                inner.parent = static_cast<int>(bySize[j]);
+                break;
+            }
+        }
+    }
 
-void LoopInvariantCheck::analyzeStmt(const clang::Stmt *S, const clang::ast_matchers::MatchFinder::MatchResult &result) {
+    // Each block belongs to its innermost loop, which is the first one found in size order
+    myproject::ArenaVector<int> innermost(numBlocks, -1, arena);
+    for (unsigned index : bySize) {
+        for (unsigned id : loops[index].blocks.set_bits()) {
+            if (innermost[id] == -1) innermost[id] = static_cast<int>(index);
+        }
+    }
+    for (unsigned id = 0; id < numBlocks; ++id) {
+        if (innermost[id] == -1 || !blocks[id]) continue;
+        for (const clang::CFGElement &Element : *blocks[id]) {
+            if (auto S = Element.getAs<clang::CFGStmt>()) noteModification(S->getStmt(), loops[innermost[id]].modified);
+        }
+    }
+    for (unsigned index : bySize) {
+        if (loops[index].parent == -1) continue;
+        const ModifiedSet &inner = loops[index].modified;
+        loops[loops[index].parent].modified.insert(inner.begin(), inner.end());
+    }
+    return loops;
+}
+
+// What a single CFG element writes: assignments, compound assignments, ++/--, variables whose address is taken
+// or that are passed by non-const reference, non-const member calls, and variables declared inside the loop
+// (they get a new value on every iteration). The CFG lists every subexpression, so there is no recursion here.
+// Lambda bodies are not part of the function's CFG: a lambda created or called in the loop may write every
+// variable it captures by reference.
+void LoopInvariantCheck::noteModification(const clang::Stmt *S, ModifiedSet &modified) const {
+    // Find the variable an lvalue expression refers to, e.g. `s` for `s.a[i]`
+    auto markModified = [&modified](const clang::Expr *E) {
+        while (E) {
+            E = E->IgnoreParenImpCasts();
+            if (const auto *ME = llvm::dyn_cast<clang::MemberExpr>(E)) {
+                if (ME->isArrow()) return;
+                E = ME->getBase();
+            } else if (const auto *ASE = llvm::dyn_cast<clang::ArraySubscriptExpr>(E)) {
+                E = ASE->getBase();
+            } else {
+                break;
+            }
+        }
+        if (const auto *DRE = llvm::dyn_cast_or_null<clang::DeclRefExpr>(E)) {
+            if (const auto *VD = llvm::dyn_cast<clang::VarDecl>(DRE->getDecl())) modified.insert(VD);
+        }
+    };
+
+    auto markCaptures = [&modified](const clang::CXXRecordDecl *Closure) {
+        for (const clang::LambdaCapture &Capture : Closure->captures()) {
+            if (!Capture.capturesVariable() || Capture.getCaptureKind() != clang::LCK_ByRef) continue;
+            if (const auto *VD = llvm::dyn_cast<clang::VarDecl>(Capture.getCapturedVar())) modified.insert(VD);
+        }
+    };
+
+    if (const auto *BO = llvm::dyn_cast<clang::BinaryOperator>(S)) {
+        if (BO->isAssignmentOp()) markModified(BO->getLHS());
+    } else if (const auto *UO = llvm::dyn_cast<clang::UnaryOperator>(S)) {
+        if (UO->isIncrementDecrementOp() || UO->getOpcode() == clang::UO_AddrOf) markModified(UO->getSubExpr());
+    } else if (const auto *DS = llvm::dyn_cast<clang::DeclStmt>(S)) {
+        for (const clang::Decl *D : DS->decls()) {
+            if (const auto *VD = llvm::dyn_cast<clang::VarDecl>(D)) modified.insert(VD);
+        }
+    } else if (const auto *LE = llvm::dyn_cast<clang::LambdaExpr>(S)) {
+        markCaptures(LE->getLambdaClass());
+    } else if (const auto *CE = llvm::dyn_cast<clang::CallExpr>(S)) {
+        const clang::FunctionDecl *Callee = CE->getDirectCallee();
+        const auto *Method = llvm::dyn_cast_or_null<clang::CXXMethodDecl>(Callee);
+        // A lambda made before the loop and called in it
+        if (Method && Method->getParent()->isLambda()) markCaptures(Method->getParent());
+        if (const auto *MCE = llvm::dyn_cast<clang::CXXMemberCallExpr>(CE)) {
+            if (Method && !Method->isConst()) markModified(MCE->getImplicitObjectArgument());
+        }
+        // A member operator call passes the object as its first argument
+        unsigned Offset = 0;
+        if (llvm::isa<clang::CXXOperatorCallExpr>(CE) && Method && !Method->isStatic()) {
+            Offset = 1;
+            if (CE->getNumArgs() && !Method->isConst()) markModified(CE->getArg(0));
+        }
+        for (unsigned I = Offset; Callee && I < CE->getNumArgs(); ++I) {
+            if (I - Offset >= Callee->getNumParams()) break;
+            clang::QualType ParamType = Callee->getParamDecl(I - Offset)->getType();
+            if (ParamType->isReferenceType() && !ParamType.getNonReferenceType().isConstQualified())
+                markModified(CE->getArg(I));
+        }
+    }
+}
+
+void LoopInvariantCheck::analyzeStmt(const clang::Stmt *S, const std::vector<Loop> &loops, unsigned index, const clang::ast_matchers::MatchFinder::MatchResult &result,
+                                     myproject::FindingSink &findings, const clang::FunctionDecl *FD, myproject::Deadline &deadline) {
     for (const clang::Stmt *Child : S->children()) {
         if (!Child) continue;
+        if (deadline.expired()) return;
 
         // Check loop invariant expressions
-        if (isLoopInvariant(Child, S, result)) {
-            reportLoopInvariant(Child, result);
+        if (!isLoopInvariant(Child, loops[index].modified, result)) continue;
+
+        // Report it once, for the outermost loop it is still invariant in
+        unsigned outermost = index;
+        for (int parent = loops[index].parent; parent != -1 && loops[parent].stmt; parent = loops[parent].parent) {
+            if (!isLoopInvariant(Child, loops[parent].modified, result)) break;
+            outermost = static_cast<unsigned>(parent);
         }
+        reportLoopInvariant(Child, outermost == index ? nullptr : loops[outermost].stmt, result, findings, FD);
     }
 }
 
@@ -106,12 +322,13 @@ void LoopInvariantCheck::analyzeStmt(const clang::Stmt *S, const clang::ast_matc
 */
 
 // Assume all unary operators will result in changes to the variable 
-bool LoopInvariantCheck::isLoopInvariant(const clang::Stmt *S, const clang::Stmt *LoopBody, const clang::ast_matchers::MatchFinder::MatchResult &result) {
+bool LoopInvariantCheck::isLoopInvariant(const clang::Stmt *S, const ModifiedSet &modified, const clang::ast_matchers::MatchFinder::MatchResult &result) {
     // Only handle binary operators for now
     if(const clang::BinaryOperator* B = llvm::dyn_cast<clang::BinaryOperator>(S)){
         const clang::Expr* RHS = B->getRHS();
     
-        if (B->getLHS()->isModifiableLvalue(*result.Context)) {
+        // isModifiableLvalue() returns MLV_Valid (0) when the LHS can be assigned
+        if (B->getLHS()->isModifiableLvalue(*result.Context) != clang::Expr::MLV_Valid) {
             return false;
         }
 
@@ -121,7 +338,7 @@ bool LoopInvariantCheck::isLoopInvariant(const clang::Stmt *S, const clang::Stmt
             if (llvm::isa<clang::IntegerLiteral>(RHS) ||
                 llvm::isa<clang::FloatingLiteral>(RHS) ||
                 llvm::isa<clang::CharacterLiteral>(RHS)) {
-                llvm::outs() << "Found a constant\n";
+                MYPROJECT_TRACE("Found a constant");
                 return true;
             }
 
@@ -138,102 +355,44 @@ bool LoopInvariantCheck::isLoopInvariant(const clang::Stmt *S, const clang::Stmt
 
             //Only return true if the function is true, otherwise jump and do nothing
 
-            if(isRightOperandInvariant(RHS, LoopBody, result)) {
+            if(isRightOperandInvariant(RHS, modified)) {
                 return true; 
             }
         }
     }
 
-    for (const clang::Stmt *Child : S->children()) {
-        if (!isLoopInvariant(Child, LoopBody, result)) {
-            return false;
-        }
-    }
-
     // Return false if no previous check passed
     return false;
 }
 
 
 
-// Return true if the variable is modified in the loop(Only handle limited cases)
-bool LoopInvariantCheck::isModifiedInLoop(const clang::VarDecl *VD, const clang::Stmt *LoopBody, const clang::ast_matchers::MatchFinder::MatchResult &result) {
-
-    llvm::outs() << "Checking if the variable is modified in the loop\n";
-    // Traverse the loop body to find modifications to the variable
-    for (const clang::Stmt* Child : LoopBody->children()) {
-        if (const clang::BinaryOperator* BO = llvm::dyn_cast<clang::BinaryOperator>(Child)) {
-            // Exclude situations for comparison operators
-            if (isComparisonOperator(BO)) {
-                if (const clang::DeclRefExpr* LHS = llvm::dyn_cast<clang::DeclRefExpr>(BO->getLHS())) {
-                    if (LHS->getDecl() == VD) {
-                        return false;  
-                    }
-                }
-            }
-
-            llvm::outs() << "Found a binary operator\n";//sssssssssssssssssssssssssssss
-            if (BO->getOpcode() == clang::BO_Assign) {
-                if (const clang::DeclRefExpr *LHS = llvm::dyn_cast<clang::DeclRefExpr>(BO->getLHS())) {
-                    if (LHS->getDecl() == VD) {
-                        // 调用 isRightOperandInvariant 函数来检查右操作数是否是 loop-invariant
-                        if (BO->getRHS() && !isRightOperandInvariant(BO->getRHS(), LoopBody, result)) {
-                            return true;
-                        }
-                    }
-                }
-            }
-        }
-
-        // Check for unary operators (self-increment or self-decrement)
-        if (const clang::UnaryOperator* UO = llvm::dyn_cast<clang::UnaryOperator>(Child)) {
-            if (UO->isIncrementDecrementOp() || UO->isArithmeticOp()) { // isIncrementDecrementOp() is used to check if the operator is ++ or --, isArithmeticOp() is used to check if the operator is + - ~ or !
-                if (const clang::DeclRefExpr* Operand  = llvm::dyn_cast<clang::DeclRefExpr>(UO->getSubExpr())) {
-                    if (Operand->getDecl() == VD) {
-                        llvm::outs() << "Found a unary operator1\n";
-                        return true;
-                    }
-                }
-            }
-        }
-
-        // Recursively check children
-        if (isModifiedInLoop(VD, Child, result)) {
-            return true;
-        }
-    }
-    return false; // Cannot find any modification
-}
-
-std::optional<bool> LoopInvariantCheck::reportLoopInvariant(const clang::Stmt *S, const clang::ast_matchers::MatchFinder::MatchResult &result) const {
+std::optional<bool> LoopInvariantCheck::reportLoopInvariant(const clang::Stmt *S, const clang::Stmt *Outermost, const clang::ast_matchers::MatchFinder::MatchResult &result,
+                                                            myproject::FindingSink &findings, const clang::FunctionDecl *FD) const {
     if (!S) return std::nullopt; // Check if the statement is empty
 
     // Get the location of the statement
     clang::SourceLocation Loc = S->getBeginLoc();
     if (Loc.isInvalid()) return std::nullopt; // If the location is invalid, return
 
-    // Setup the diagnostic engine
-    clang::DiagnosticsEngine &Diag = result.Context->getDiagnostics();
-    unsigned DiagID = Diag.getCustomDiagID(clang::DiagnosticsEngine::Warning,
-                                           "Expression is loop-invariant and can be moved out of the loop");
-
-    // Trigger engine to report the diagnostic
-    Diag.Report(Loc, DiagID);
+    // Hand the finding over, the MatchCallback decides when and how it is emitted
+    // The line of the enclosing loop is filled in when the finding is emitted, on the thread owning the SourceManager
+    if (Outermost) {
+        findings.report({getName(), Loc, "Expression is loop-invariant and can be moved out of the enclosing loop at line {related-line}",
+                         FD->getQualifiedNameAsString(), Outermost->getBeginLoc()});
+    } else {
+        findings.report({getName(), Loc, "Expression is loop-invariant and can be moved out of the loop", FD->getQualifiedNameAsString()});
+    }
     return true;
 }
 
-bool LoopInvariantCheck::isRightOperandInvariant(const clang::Expr *RHS, const clang::Stmt *LoopBody, const clang::ast_matchers::MatchFinder::MatchResult &result) {
-    // 判断右操作数是否为 modifiable lvalue
-    if (!RHS->isModifiableLvalue(*result.Context)) {
-        return true;
-    }
-
+bool LoopInvariantCheck::isRightOperandInvariant(const clang::Expr *RHS, const ModifiedSet &modified) {
     // 检查右操作数是否是 DeclRefExpr
-    if (const clang::DeclRefExpr *DRE = llvm::dyn_cast<clang::DeclRefExpr>(RHS)) {
+    if (const clang::DeclRefExpr *DRE = llvm::dyn_cast<clang::DeclRefExpr>(RHS->IgnoreParenImpCasts())) {
         // 判断是否是 VarDecl
         if (const clang::VarDecl *VD = llvm::dyn_cast<clang::VarDecl>(DRE->getDecl())) {
             // 如果变量没有在循环中被修改，则认为右操作数是 loop-invariant
-            if(!isModifiedInLoop(VD, LoopBody, result)) return true;
+            return !modified.count(VD);
         }
     }
 
@@ -1,52 +1,601 @@
 #include "MatchCallback.h"
+#include <clang/Lex/Lexer.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/xxhash.h>
 
 namespace myproject {
 
-MyMatchCallback::MyMatchCallback(clang::DiagnosticsEngine &diagEngine)
-    : diagEngine(diagEngine), count(0), checks() {}
+namespace cam = clang::ast_matchers;
 
+// Passes findings on and keeps a copy, for the function memo
+class RecordingSink : public FindingSink {
+public:
+    explicit RecordingSink(FindingSink& next) : next(next) {}
+    void report(Finding finding) override {
+        findings.push_back(finding);
+        next.report(std::move(finding));
+    }
+    std::vector<Finding> findings;
+private:
+    FindingSink& next;
+};
+
+// Count the statements of S, stops once there are more than `limit`
+static unsigned countStatements(const clang::Stmt* S, unsigned limit) {
+    unsigned count = 0;
+    llvm::SmallVector<const clang::Stmt*, 64> stack{S};
+    while (!stack.empty() && count <= limit) {
+        const clang::Stmt* top = stack.pop_back_val();
+        if (!top) continue;
+        ++count;
+        for (const clang::Stmt* child : top->children()) stack.push_back(child);
+    }
+    return count;
+}
+
+CheckCallback::CheckCallback(CheckStrategy& check, MyMatchCallback& owner, std::string id)
+    : check(check), owner(owner), id(std::move(id)) {}
+
+void CheckCallback::run(const clang::ast_matchers::MatchFinder::MatchResult& result) {
+    ++matches;
+    owner.dispatch(check, result);
+}
+
+// The entry of FD in the list of skipped functions
+static FunctionBudget::Skipped skipped(const clang::FunctionDecl* FD, const clang::SourceManager& sm, std::string reason) {
+    clang::PresumedLoc presumed = sm.getPresumedLoc(sm.getFileLoc(FD->getLocation()));
+    std::string location = presumed.isValid() ? std::format("{}:{}", presumed.getFilename(), presumed.getLine()) : "<unknown>";
+    return {std::move(location), FD->getQualifiedNameAsString(), std::move(reason)};
+}
+
+static cam::MatchFinder::MatchFinderOptions finderOptions(llvm::StringMap<llvm::TimeRecord>& records, bool profile) {
+    cam::MatchFinder::MatchFinderOptions options;
+    if (profile) options.CheckProfiling.emplace(records);
+    return options;
+}
+
+MyMatchCallback::MyMatchCallback(TimeReport* timeReport)
+    : finder(finderOptions(matcherRecords, timeReport != nullptr)), count(0), checks(), timeReport(timeReport) {}
+
+void MyMatchCallback::restrictTraversalScope(std::vector<std::string> files) {
+    limitScope = true;
+    scopeFiles = std::move(files);
+}
+
+void MyMatchCallback::setFunctionJobs(unsigned jobs) {
+    functionJobs = jobs;
+}
+
+void MyMatchCallback::recordPhase(const std::string& phase, double seconds) {
+    if (timeReport) times.phases[phase].add(seconds);
+}
+
+void MyMatchCallback::matchAST(clang::ASTContext& context) {
+    emitter.setDiagnostics(&context.getDiagnostics());
+    if (timeReport) {
+        const clang::SourceManager& sm = context.getSourceManager();
+        const clang::FileEntry* mainFile = sm.getFileEntryForID(sm.getMainFileID());
+        times.file = mainFile ? mainFile->getName().str() : "<unknown>";
+    }
+    if (limitScope || changedLines) context.setTraversalScope(collectTraversalScope(context));
+    if (resultCache) emitter.setRecording(&tuResult.findings);
+    if (resultCache && useFunctionMemo) previousMemo = resultCache->loadFunctionMemo(context.getSourceManager());
+
+    Stopwatch matchWatch;
+    if (!callbacks.empty()) finder.matchAST(context);
+    if (walker) {
+        walker->walk(context, [this](CheckStrategy& check, const cam::MatchFinder::MatchResult& result) { dispatch(check, result); });
+    }
+    // The checks run from inside the traversal are accounted for separately
+    recordPhase("match", matchWatch.seconds() - serialCheckSeconds);
+
+    if (!deferred.empty()) runDeferred();
+    // Leave the context as we found it, other consumers expect to see the whole TU
+    if (limitScope || changedLines) context.setTraversalScope({context.getTranslationUnitDecl()});
+    if (resultCache && useFunctionMemo) storeFunctionMemo(context.getSourceManager());
+    if (resultCache) storeResult(context);
+
+    // Measured while the AST is still alive, it is freed right after this
+    const clang::SourceManager& sm = context.getSourceManager();
+    const clang::FileEntry* mainFile = sm.getFileEntryForID(sm.getMainFileID());
+    lastTUMemory = {mainFile ? mainFile->getName().str() : "<unknown>", translationUnitBytes(context), peakRSS()};
+    if (timeReport) {
+        times.tuBytes = lastTUMemory.tuBytes;
+        times.peakRSS = lastTUMemory.peakRSS;
+    }
+    if (memoryReport) memoryReport->add(lastTUMemory);
+    onEndOfTranslationUnit();
+}
+
+void MyMatchCallback::beginTranslationUnit() {
+    lastTUMemory = TUMemory();
+    if (resetPeakPerTU) resetPeakRSS();
+}
 
-void MyMatchCallback::run(const clang::ast_matchers::MatchFinder::MatchResult& result) {
-    // why??? it is so werid that if i use if-else statement, the check in else if will not be executed
-    if(checks.find("dead-stores") != checks.end()) {
-        checks["dead-stores"]->check(result);
+void MyMatchCallback::dispatch(CheckStrategy& check, const clang::ast_matchers::MatchFinder::MatchResult& result) {
+    const clang::FunctionDecl* FD = check.analyzedFunction(result);
+    // Before claiming it, a function this TU does not analyze must stay available to the other TUs
+    if (FD && changedLines && !isChanged(FD, *result.SourceManager)) return;
+    SharedFunction* shared = FD && analyzedFunctions ? &sharedFunction(FD, *result.SourceManager) : nullptr;
+    // Its findings have been reported by the TU that analyzed it first
+    if (shared && shared->analyzedElsewhere) return;
+    // Likewise a header function over the size limits of this TU's budget: the verdict comes before the claim
+    bool isShared = shared && !shared->key.empty();
+    if (isShared) {
+        if (budget && !withinBudget(FD, result, true)) return;
+        if (!claimSharedFunction(*shared)) return;
     }
 
-    if(checks.find("unreachable-code") != checks.end()) {
-        checks["unreachable-code"]->check(result);
+    MemoFunction* memo = FD && useFunctionMemo && resultCache ? memoFunction(FD, *result.SourceManager) : nullptr;
+    emitter.setSharedFunction(shared ? shared->key : std::string());
+    if (memo && replayMemo(*memo, check, FD, *result.SourceManager)) return;
+
+    if (FD && budget && !withinBudget(FD, result, isShared)) return;
+
+    if (FD && functionJobs != 1) {
+        // Matches of one function arrive back to back, keep them together so its CFG is built once
+        if (deferred.empty() || deferred.back().function->getCanonicalDecl() != FD->getCanonicalDecl()) {
+            deferred.push_back({FD, shared ? shared->key : std::string(), {}});
+            if (budgetContext && budgetContext->getDecl()->getCanonicalDecl() == FD->getCanonicalDecl())
+                deferred.back().prebuilt = std::move(budgetContext);
+            budgetContext.reset();
+        }
+        deferred.back().matches.push_back({&check, result});
+        return;
     }
-    
-    if(checks.find("uninitialized-variable") != checks.end()) {
-        llvm::outs() << "uninitializedvar is not found\n";
+    // Under a time limit the findings are held back until the check is done, a check that runs out of time
+    // reports nothing for the function
+    bool limited = FD && budget && budget->getLimits().maxSeconds > 0;
+    RecordingSink recording(emitter);
+    FindingSink& sink = memo ? static_cast<FindingSink&>(recording) : emitter;
+    FindingBuffer held;
+    CheckContext context{analysisCache, limited ? held : sink, limited ? deadline() : Deadline(), useArena ? &arena : nullptr};
+    auto finish = [&] {
+        arena.Reset();
+        if (context.deadline.wasExpired()) {
+            dropTimedOut(FD, *result.SourceManager, check);
+            return;
+        }
+        for (const auto& finding : held.getFindings()) sink.report(finding);
+        if (memo) recordMemo(*memo, check.getName(), recording.findings, *result.SourceManager);
+    };
+    if (!timeReport) {
+        check.check(result, context);
+        finish();
+        return;
     }
-    
-    if(checks.find("loop-invariant") != checks.end()) {
-        checks["loop-invariant"]->check(result);
+
+    double cfgBefore = analysisCache.getCFGTime().seconds;
+    Stopwatch watch;
+    check.check(result, context);
+    double seconds = watch.seconds();
+    finish();
+    double checkSeconds = seconds - (analysisCache.getCFGTime().seconds - cfgBefore);
+    serialCheckSeconds += seconds;
+    times.checks[check.getName()].add(checkSeconds);
+    times.phases["checks"].add(checkSeconds);
+    if (FD) recordFunction(FD, seconds, analysisCache.getCachedCFG(FD));
+}
+
+// Check FD against the size limits on its first match, the verdict holds for all its matches in this TU.
+// In the parallel function mode the CFG is built by runDeferred, which checks its size there. A header
+// function `shared` with other TUs cannot wait for that, it is only claimed once it passed: its CFG is
+// built here and handed to runDeferred.
+bool MyMatchCallback::withinBudget(const clang::FunctionDecl* FD, const clang::ast_matchers::MatchFinder::MatchResult& result,
+                                   bool shared) {
+    auto [it, inserted] = budgetVerdicts.try_emplace(FD->getCanonicalDecl(), true);
+    if (!inserted) return it->second;
+
+    const BudgetLimits& limits = budget->getLimits();
+    if (limits.maxASTNodes && countStatements(FD->getBody(), limits.maxASTNodes) > limits.maxASTNodes) {
+        skipFunction(FD, *result.SourceManager, std::format("more than {} AST nodes", limits.maxASTNodes));
+        return false;
     }
+    if (limits.maxCFGBlocks && (functionJobs == 1 || shared)) {
+        // Every check builds the CFG right after this anyway, the cache keeps it for them
+        const clang::CFG* cfg = nullptr;
+        if (functionJobs == 1) {
+            cfg = analysisCache.getCFG(FD, *result.Context);
+        } else {
+            budgetContext = AnalysisCache::buildContext(FD);
+            cfg = budgetContext ? budgetContext->getCFG() : nullptr;
+        }
+        if (cfg && cfg->getNumBlockIDs() > limits.maxCFGBlocks) {
+            skipFunction(FD, *result.SourceManager, std::format("{} CFG blocks", cfg->getNumBlockIDs()));
+            return false;
+        }
+    }
+    return true;
+}
 
+// Give up on FD for the rest of the TU and tell the budget why
+void MyMatchCallback::skipFunction(const clang::FunctionDecl* FD, const clang::SourceManager& sm, std::string reason) {
+    budgetVerdicts[FD->getCanonicalDecl()] = false;
+    budget->skip(skipped(FD, sm, std::move(reason)));
 }
 
+// A check ran out of time on FD: only its findings are dropped, the other checks of FD still run and report,
+// with and without --function-jobs. The function is listed as skipped once per check that timed out. A header
+// function stays claimed: the other checks reported it, and the time limit depends on the load anyway.
+void MyMatchCallback::dropTimedOut(const clang::FunctionDecl* FD, const clang::SourceManager& sm, const CheckStrategy& check) {
+    timedOut = true;
+    budget->skip(skipped(FD, sm, std::format("time limit in {}", check.getName())));
+}
+
+// The time limit of one check on one function
+Deadline MyMatchCallback::deadline() const {
+    return budget && budget->getLimits().maxSeconds > 0 ? Deadline(budget->getLimits().maxSeconds) : Deadline();
+}
+
+// The sharing state of FD, looked up on its first match. Functions of the main file are never shared with other TUs.
+MyMatchCallback::SharedFunction& MyMatchCallback::sharedFunction(const clang::FunctionDecl* FD, const clang::SourceManager& sm) {
+    auto [it, inserted] = sharedFunctions.try_emplace(FD->getCanonicalDecl());
+    if (!inserted) return it->second;
+
+    const clang::FunctionDecl* definition = FD->getDefinition();
+    if (!definition || sm.isInMainFile(sm.getExpansionLoc(definition->getLocation()))) return it->second;
+    if (std::optional<std::string> key = AnalyzedFunctions::key(definition)) {
+        // Claims are never given back, claim() only counts the skip here
+        if (analyzedFunctions->isClaimed(*key)) it->second.analyzedElsewhere = !analyzedFunctions->claim(*key);
+        it->second.key = std::move(*key);
+    }
+    return it->second;
+}
+
+// Claim a shared function for this TU, false if another TU was first
+bool MyMatchCallback::claimSharedFunction(SharedFunction& shared) {
+    if (!shared.claimed && !shared.analyzedElsewhere) {
+        shared.claimed = analyzedFunctions->claim(shared.key);
+        shared.analyzedElsewhere = !shared.claimed;
+    }
+    return shared.claimed;
+}
 
+// The memo state of FD in this TU, nullptr if FD cannot be memoized
+MyMatchCallback::MemoFunction* MyMatchCallback::memoFunction(const clang::FunctionDecl* FD, const clang::SourceManager& sm) {
+    auto [it, inserted] = memoFunctions.try_emplace(FD->getCanonicalDecl());
+    MemoFunction& memo = it->second;
+    if (inserted) {
+        const clang::FunctionDecl* definition = FD->getDefinition();
+        clang::SourceLocation begin = definition ? sm.getFileLoc(definition->getBeginLoc()) : clang::SourceLocation();
+        std::optional<std::string> key = begin.isValid() ? FunctionMemo::key(definition) : std::nullopt;
+        // The ODR hash ignores locations. Findings are stored as line offsets and columns, so any change to the
+        // text of the function (a blank line, a comment, indentation) has to analyze it again, as does moving it sideways.
+        clang::SourceLocation end = key ? sm.getFileLoc(definition->getEndLoc()) : clang::SourceLocation();
+        if (end.isInvalid() || sm.getFileID(end) != sm.getFileID(begin)) key.reset();
+        if (key) {
+            llvm::StringRef text = clang::Lexer::getSourceText(clang::CharSourceRange::getTokenRange(begin, end), sm,
+                                                               definition->getASTContext().getLangOpts());
+            memo.key = std::format("{}@{}#{:016x}", *key, sm.getSpellingColumnNumber(begin), llvm::xxHash64(text));
+            memo.file = sm.getFileID(begin);
+            memo.firstLine = sm.getSpellingLineNumber(begin);
+        }
+    }
+    return memo.key.empty() ? nullptr : &memo;
+}
 
+// Report the findings `check` had on the same function in the last run. Returns false if the check has to run.
+bool MyMatchCallback::replayMemo(MemoFunction& memo, CheckStrategy& check, const clang::FunctionDecl* FD,
+                                 const clang::SourceManager& sm) {
+    const MemoEntry* previous = previousMemo.find(memo.key, check.getName());
+    if (!previous) return false;
+    if (llvm::is_contained(memo.entry.checks, check.getName())) return true; // Already reported for an earlier match
+
+    memo.entry.checks.push_back(check.getName());
+    for (const MemoFinding& finding : previous->findings) {
+        if (finding.check != check.getName()) continue;
+        memo.entry.findings.push_back(finding);
+        clang::SourceLocation loc = sm.translateLineCol(memo.file, memo.firstLine + finding.line, finding.column);
+        clang::SourceLocation related;
+        if (finding.hasRelated) related = sm.translateLineCol(memo.file, memo.firstLine + finding.relatedLine, finding.relatedColumn);
+        emitter.report({finding.check, loc, finding.message, FD->getQualifiedNameAsString(), related});
+    }
+    ++memoHits;
+    return true;
+}
+
+// Keep what `check` found in the function for the next run. A finding outside of the function's own file
+// cannot be placed relative to it, the function is then not memoized at all.
+void MyMatchCallback::recordMemo(MemoFunction& memo, const std::string& check, const std::vector<Finding>& findings,
+                                 const clang::SourceManager& sm) {
+    if (memo.key.empty()) return;
+    if (!llvm::is_contained(memo.entry.checks, check)) {
+        memo.entry.checks.push_back(check);
+        ++memoMisses;
+    }
+    // Line and column of `loc` relative to the function, false if it is not in the function's file
+    auto relative = [&](clang::SourceLocation loc, unsigned& line, unsigned& column) {
+        loc = loc.isValid() ? sm.getFileLoc(loc) : clang::SourceLocation();
+        if (loc.isInvalid() || sm.getFileID(loc) != memo.file) return false;
+        unsigned absolute = sm.getSpellingLineNumber(loc);
+        if (absolute < memo.firstLine) return false;
+        line = absolute - memo.firstLine;
+        column = sm.getSpellingColumnNumber(loc);
+        return true;
+    };
+    for (const Finding& finding : findings) {
+        if (finding.check != check) continue;
+        MemoFinding memoFinding{finding.check, 0, 0, finding.message};
+        bool placed = relative(finding.loc, memoFinding.line, memoFinding.column);
+        if (placed && finding.related.isValid()) {
+            memoFinding.hasRelated = true;
+            placed = relative(finding.related, memoFinding.relatedLine, memoFinding.relatedColumn);
+        }
+        if (!placed) {
+            memo.key.clear();
+            return;
+        }
+        memo.entry.findings.push_back(std::move(memoFinding));
+    }
+}
+
+// Replace the memo of the main file with the functions of this TU, functions that are gone drop out
+void MyMatchCallback::storeFunctionMemo(const clang::SourceManager& sm) {
+    FunctionMemo next;
+    for (auto& entry : memoFunctions) {
+        MemoFunction& memo = entry.second;
+        if (!memo.key.empty() && !memo.entry.checks.empty()) next.functions[memo.key] = std::move(memo.entry);
+    }
+    resultCache->storeFunctionMemo(sm, next);
+    resultCache->countFunctionMemo(memoHits, memoMisses);
+
+    previousMemo = FunctionMemo();
+    memoFunctions.clear();
+    memoHits = memoMisses = 0;
+}
+
+// Hand the findings of the TU to the cache, with the header functions it claimed so a later run that
+// answers the TU from the cache can claim them again, and the ones it left to other TUs
+void MyMatchCallback::storeResult(const clang::ASTContext& context) {
+    emitter.setRecording(nullptr);
+    for (const auto& check : checks) tuResult.checks.push_back(check->getName());
+    for (const auto& entry : sharedFunctions) {
+        if (entry.second.claimed) tuResult.sharedFunctions.push_back(entry.second.key);
+        if (entry.second.analyzedElsewhere) tuResult.skippedFunctions.push_back(entry.second.key);
+    }
+    // Another run may well finish the functions this one ran out of time on. A TU that did not compile was
+    // analyzed from a partial AST, and what broke it (a missing or generated header) may be fixed without
+    // any of its dependencies changing.
+    if (!timedOut && !context.getDiagnostics().hasErrorOccurred())
+        resultCache->store(context.getSourceManager(), std::move(tuResult));
+    tuResult = TUResult();
+}
+
+// Add time spent on FD, the list of slowest functions is built from these
+void MyMatchCallback::recordFunction(const clang::FunctionDecl* FD, double seconds, const clang::CFG* cfg) {
+    auto [it, inserted] = functionIndex.try_emplace(FD->getCanonicalDecl(), times.functions.size());
+    if (inserted) times.functions.push_back({times.file, FD->getQualifiedNameAsString()});
+    FunctionTime& function = times.functions[it->second];
+    function.seconds += seconds;
+    if (cfg) function.cfgBlocks = cfg->getNumBlockIDs();
+}
+
+// Analyze the collected functions on the pool. Each function gets its own AnalysisCache and FindingBuffer,
+// and the buffers are emitted in match order afterwards, so the output does not depend on scheduling.
+void MyMatchCallback::runDeferred() {
+    if (!pool) pool = std::make_unique<llvm::ThreadPool>(llvm::hardware_concurrency(functionJobs));
+
+    Stopwatch deferredWatch;
+    std::vector<FindingBuffer> buffers(deferred.size());
+    std::vector<std::shared_ptr<clang::AnalysisDeclContext>> contexts(deferred.size());
+    std::vector<double> cfgSeconds(deferred.size(), 0);
+    for (size_t i = 0; i < deferred.size(); ++i) {
+        // The CFG is built here because building it touches the ASTContext. The workers only read the AST
+        // and their own CFG (LiveVariables, reachability, ...)
+        Stopwatch cfgWatch;
+        std::shared_ptr<clang::AnalysisDeclContext> prebuilt = deferred[i].prebuilt ? std::move(deferred[i].prebuilt)
+                                                                                    : AnalysisCache::buildContext(deferred[i].function);
+        cfgSeconds[i] = cfgWatch.seconds();
+        if (timeReport) contexts[i] = prebuilt;
+        const clang::CFG* cfg = prebuilt ? prebuilt->getCFG() : nullptr;
+        unsigned maxBlocks = budget ? budget->getLimits().maxCFGBlocks : 0;
+        if (maxBlocks && cfg && cfg->getNumBlockIDs() > maxBlocks) {
+            deferred[i].overBudget = true;
+            skipFunction(deferred[i].function, *deferred[i].matches.front().result.SourceManager,
+                         std::format("{} CFG blocks", cfg->getNumBlockIDs()));
+            continue;
+        }
+        pool->async([this, i, &buffers, prebuilt] {
+            static thread_local Arena workerArena;
+            AnalysisCache cache(prebuilt);
+            CheckContext context{cache, buffers[i]};
+            if (useArena) context.arena = &workerArena;
+            FunctionWork& work = deferred[i];
+            if (timeReport) work.seconds.resize(work.matches.size());
+            for (size_t m = 0; m < work.matches.size(); ++m) {
+                context.deadline = deadline();
+                Stopwatch watch;
+                work.matches[m].check->check(work.matches[m].result, context);
+                if (timeReport) work.seconds[m] = watch.seconds();
+                workerArena.Reset();
+                work.matches[m].end = buffers[i].getFindings().size();
+                work.matches[m].timedOut = context.deadline.wasExpired();
+            }
+        });
+    }
+    pool->wait();
+
+    if (timeReport) {
+        // Check times are summed over the workers, "function-jobs" is the wall time of the whole pass
+        recordPhase("function-jobs", deferredWatch.seconds());
+        for (size_t i = 0; i < deferred.size(); ++i) {
+            const FunctionWork& work = deferred[i];
+            double total = cfgSeconds[i];
+            for (size_t m = 0; m < work.seconds.size(); ++m) {
+                times.checks[work.matches[m].check->getName()].add(work.seconds[m]);
+                times.phases["checks"].add(work.seconds[m]);
+                total += work.seconds[m];
+            }
+            times.phases["cfg"].add(cfgSeconds[i]);
+            recordFunction(work.function, total, contexts[i] ? contexts[i]->getCFG() : nullptr);
+        }
+    }
+
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        if (deferred[i].overBudget) continue;
+        const clang::SourceManager& sm = *deferred[i].matches.front().result.SourceManager;
+        // Each match owns the findings from the end of the previous one to its own end, like the serial
+        // dispatch() only the ones of a check that timed out are dropped
+        const std::vector<Finding>& findings = buffers[i].getFindings();
+        std::vector<Finding> kept;
+        llvm::SmallVector<const CheckStrategy*, 4> expired;
+        size_t begin = 0;
+        for (const DeferredMatch& match : deferred[i].matches) {
+            if (match.timedOut) {
+                dropTimedOut(deferred[i].function, sm, *match.check);
+                expired.push_back(match.check);
+            } else {
+                kept.insert(kept.end(), findings.begin() + begin, findings.begin() + match.end);
+            }
+            begin = match.end;
+        }
+        emitter.setSharedFunction(deferred[i].sharedFunction);
+        for (const auto& finding : kept) emitter.report(finding);
+        if (useFunctionMemo && resultCache) {
+            MemoFunction* memo = memoFunction(deferred[i].function, sm);
+            // Record each check once with all of its findings, a check that timed out has none to remember
+            llvm::SmallVector<const CheckStrategy*, 4> recorded;
+            for (const DeferredMatch& match : deferred[i].matches) {
+                if (!memo || llvm::is_contained(recorded, match.check) || llvm::is_contained(expired, match.check)) continue;
+                recorded.push_back(match.check);
+                recordMemo(*memo, match.check->getName(), kept, sm);
+            }
+        }
+    }
+    emitter.setSharedFunction({});
+    deferred.clear();
+}
+
+// Collect the top-level declarations that belong to the main file or to one of the scope files
+std::vector<clang::Decl*> MyMatchCallback::collectTraversalScope(clang::ASTContext& context) {
+    const clang::SourceManager& sm = context.getSourceManager();
+    llvm::DenseMap<clang::FileID, bool> inScope; // Remember the answer per file, a header declares many decls
+    std::vector<clang::Decl*> scope;
+
+    for (clang::Decl* decl : context.getTranslationUnitDecl()->decls()) {
+        clang::SourceLocation loc = sm.getExpansionLoc(decl->getLocation());
+        if (loc.isInvalid()) continue; // Builtin and implicit declarations
+
+        if (limitScope) {
+            clang::FileID fid = sm.getFileID(loc);
+            auto [it, inserted] = inScope.try_emplace(fid, false);
+            if (inserted) it->second = isInTraversalScope(sm, fid);
+            if (!it->second) continue;
+        }
+        if (changedLines && !isChanged(decl, sm)) continue;
+        scope.push_back(decl);
+    }
+    return scope;
+}
+
+// True if the lines of D overlap the changed lines of its file
+bool MyMatchCallback::isChanged(const clang::Decl* D, const clang::SourceManager& sm) {
+    clang::SourceLocation begin = sm.getExpansionLoc(D->getBeginLoc());
+    clang::SourceLocation end = sm.getExpansionLoc(D->getEndLoc());
+    if (begin.isInvalid()) return false;
+
+    clang::FileID fid = sm.getFileID(begin);
+    auto [it, inserted] = changedRanges.try_emplace(fid, nullptr);
+    if (inserted) {
+        if (const clang::FileEntry* entry = sm.getFileEntryForID(fid)) {
+            it->second = changedLines->find(entry->getName());
+            if (!it->second && !entry->tryGetRealPathName().empty()) it->second = changedLines->find(entry->tryGetRealPathName());
+        }
+    }
+    if (!it->second) return false;
+
+    unsigned first = sm.getExpansionLineNumber(begin);
+    unsigned last = end.isValid() && sm.getFileID(end) == fid ? sm.getExpansionLineNumber(end) : first;
+    return ChangedLines::overlaps(*it->second, first, last);
+}
+
+bool MyMatchCallback::isInTraversalScope(const clang::SourceManager& sm, clang::FileID fid) const {
+    if (fid == sm.getMainFileID()) return true;
+
+    const clang::FileEntry* entry = sm.getFileEntryForID(fid);
+    if (!entry) return false;
+
+    llvm::StringRef name = entry->getName();
+    for (const auto& file : scopeFiles) {
+        if (name == file || name.endswith("/" + file)) return true;
+    }
+    return false;
+}
+
+// Drop everything that refers to the finished TU, the checks themselves are kept for the next one
 void MyMatchCallback::onEndOfTranslationUnit() {
-    for(auto&& [name, strategy] : checks) {
+    for (auto& check : checks) check->onEndOfTranslationUnit();
+    if (timeReport) submitTimes();
+    // Give back what the TU needed, a worker may hold on to this callback while other TUs run
+    analysisCache.clear();
+    emitter.setDiagnostics(nullptr);
+    sharedFunctions.shrink_and_clear();
+    changedRanges.shrink_and_clear();
+    budgetVerdicts.shrink_and_clear();
+    budgetContext.reset();
+    std::vector<FunctionWork>().swap(deferred);
+    arena.Reset();
+    timedOut = false;
+}
+
+// Hand the timings of the finished TU to the report and start over
+void MyMatchCallback::submitTimes() {
+    const TimeStat& cfg = analysisCache.getCFGTime();
+    if (cfg.calls) times.phases["cfg"].add(cfg);
+
+    // Matcher times include the check() calls made from inside the traversal
+    for (auto& callback : callbacks) {
+        TimeStat& stat = times.matchers[callback->getID().str()];
+        auto record = matcherRecords.find(callback->getID());
+        if (record != matcherRecords.end()) stat.seconds += record->second.getWallTime();
+        stat.calls += callback->matches;
+        callback->matches = 0;
     }
+    matcherRecords.clear();
+
+    timeReport->add(std::move(times));
+    times = TUTimes();
+    functionIndex.clear();
+    serialCheckSeconds = 0;
 }
 
 // Add a check to the callback
-bool MyMatchCallback::AddCheck(std::unique_ptr<CheckStrategy>&& check) {
+bool MyMatchCallback::AddCheck(std::unique_ptr<CheckStrategy>&& check, clang::TraversalKind kind) {
     if (!check) {  // Make sure the check is not null
         llvm::errs() << "Error: Attempted to add a null check.\n";
         return false;
     }
 
-    const std::string& checkName = check->getName();
-    if (checks.find(checkName) != checks.end()) {
-        llvm::errs() << "Check already exists: " << checkName << "\n";
-        return false;
+    const std::string checkName = check->getName();
+    for (const auto& existing : checks) {
+        if (existing->getName() == checkName) {
+            llvm::errs() << "Check already exists: " << checkName << "\n";
+            return false;
+        }
     }
 
-    checks[checkName] = std::move(check);
+    if (fused && check->getFunctionVisitor()) {
+        checks.push_back(std::move(check));
+        walkerChecks.push_back(checks.back().get());
+        if (!walker) walker.emplace(walkerChecks, kind);
+        return true;
+    }
+
+    CheckStrategy::MatchersList matchers = check->getMatchers();
+    checks.push_back(std::move(check));
+
+    // Every matcher is bound to a callback of its own check, so a match only reaches the check that asked for it.
+    // The matchers are typed, they go to the finder as they are with only the traversal kind added.
+    size_t firstCallback = callbacks.size();
+    auto addCallback = [&] {
+        size_t index = callbacks.size() - firstCallback;
+        callbacks.push_back(std::make_unique<CheckCallback>(*checks.back(), *this, std::format("{}[{}]", checkName, index)));
+        return callbacks.back().get();
+    };
+    for (const auto& matcher : matchers.declarations) finder.addMatcher(cam::traverse(kind, matcher), addCallback());
+    for (const auto& matcher : matchers.statements) finder.addMatcher(cam::traverse(kind, matcher), addCallback());
     return true;
 }
 
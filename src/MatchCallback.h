@@ -4,31 +4,215 @@
 #include <clang/ASTMatchers/ASTMatchers.h>
 #include <clang/ASTMatchers/ASTMatchFinder.h>
 #include <clang/Basic/Diagnostic.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Timer.h>
 #include <llvm/Support/raw_ostream.h>
 #include <format>
 #include <string>
-#include <unordered_map> 
+#include <vector>
 #include "CheckStrategies.h"
+#include "AnalysisCache.h"
+#include "AnalyzedFunctions.h"
+#include "ChangedLines.h"
+#include "Findings.h"
+#include "FunctionBudget.h"
+#include "FusedWalker.h"
+#include "MemoryUsage.h"
+#include "ResultCache.h"
+#include "TimeReport.h"
 #include <memory>
+#include <optional>
 
 
 namespace myproject {
 
-class MyMatchCallback : public clang::ast_matchers::MatchFinder::MatchCallback {
+class MyMatchCallback;
+
+// Forwards the matches of one matcher to the check that registered it. The MatchFinder calls the
+// right callback directly, so dispatching a match costs the same no matter how many checks run.
+// There is one callback per matcher so MatchFinder profiling can tell the matchers apart by getID().
+class CheckCallback : public clang::ast_matchers::MatchFinder::MatchCallback {
 public:
-    explicit MyMatchCallback(clang::DiagnosticsEngine& diagEngine);
+    CheckCallback(CheckStrategy& check, MyMatchCallback& owner, std::string id);
 
     void run(const clang::ast_matchers::MatchFinder::MatchResult& result) override;
-    bool AddCheck(std::unique_ptr<CheckStrategy>&& check);
-    void onEndOfTranslationUnit() override;
+    llvm::StringRef getID() const override { return id; }
+    CheckStrategy& getCheck() const { return check; }
+
+    uint64_t matches = 0; // Since the end of the last TU
 private:
-    clang::DiagnosticsEngine& diagEngine;
+    CheckStrategy& check;
+    MyMatchCallback& owner;
+    std::string id;
+};
+
+// Owns the configured checks and the MatchFinder their matchers are registered with. It is built
+// once and reused for every TU handled by the same worker; only the per-TU state is reset.
+class MyMatchCallback {
+public:
+    // With a TimeReport, MatchFinder profiling is enabled and every TU adds its timings to the report
+    explicit MyMatchCallback(TimeReport* timeReport = nullptr);
+
+    // Add a check and register its matchers with the finder. Every match of these matchers is sent to this check only
+    // With the fused walker, a check that has a FunctionVisitor is run by the walker instead
+    bool AddCheck(std::unique_ptr<CheckStrategy>&& check, clang::TraversalKind kind);
+
+    // Run the checks that support it from one FusedWalker pass per TU instead of their matchers. Call it before AddCheck.
+    void setFusedWalker(bool enabled) { fused = enabled; }
+
+    // Only traverse the top-level declarations of the main file and of `files` (matched by path suffix)
+    // instead of the whole TU, so functions from unrelated headers are never visited by the matchers
+    void restrictTraversalScope(std::vector<std::string> files);
+
+    // True for the main file and the files given to restrictTraversalScope
+    bool isInTraversalScope(const clang::SourceManager& sm, clang::FileID fid) const;
+
+    // Analyze up to `jobs` functions of a TU at the same time (0 = all cores). Matches of checks that report an
+    // analyzedFunction() are collected while matching and run on a thread pool afterwards.
+    void setFunctionJobs(unsigned jobs);
+
+    // Stream the findings to `writer` instead of reporting them as warnings of each TU
+    void setFindingWriter(FindingWriter* writer) { emitter.setWriter(writer); }
+
+    // Skip header functions that another TU sharing `shared` has already analyzed
+    void setAnalyzedFunctions(AnalyzedFunctions* shared) { analyzedFunctions = shared; }
+
+    // Store the findings of every TU in `cache`. Only TUs the cache has been asked about are stored.
+    void setResultCache(ResultCache* cache) { resultCache = cache; }
+
+    // Only analyze functions whose source range overlaps `changed`, and only traverse the top-level
+    // declarations that do. Findings are then limited to the functions touched by a patch.
+    void setChangedLines(const ChangedLines* changed) { changedLines = changed; }
+
+    // With a ResultCache, answer the functions that did not change since the last run from their memo,
+    // without building their CFG
+    void setFunctionMemo(bool enabled) { useFunctionMemo = enabled; }
+
+    // Skip functions over the size limits of `budget`. A check that runs out of time on a function reports
+    // nothing for it, the other checks of the function still run, with and without --function-jobs.
+    // Skipped functions and timed out checks are listed in `budget`.
+    void setBudget(FunctionBudget* budget) { this->budget = budget; }
+
+    // Give the checks an Arena for their per-function temporaries (on by default), reset after every check()
+    void setCheckArena(bool enabled) { useArena = enabled; }
+
+    // Add the memory of every TU to `report`. With `perTUPeak` (only one TU in the process at a time) the peak
+    // RSS starts over with each TU, otherwise it is the process peak when the TU ends.
+    void setMemoryReport(MemoryReport* report, bool perTUPeak) {
+        memoryReport = report;
+        resetPeakPerTU = perTUPeak;
+    }
+    // Memory of the last TU handled by matchAST
+    const TUMemory& getLastTUMemory() const { return lastTUMemory; }
+
+    // Called by the FrontendAction before a TU is parsed
+    void beginTranslationUnit();
+
+    // Run every registered matcher over one TU
+    void matchAST(clang::ASTContext& context);
+    void onEndOfTranslationUnit();
+
+    // Add time spent on the current TU outside of matchAST (e.g. parsing), ignored without a TimeReport
+    void recordPhase(const std::string& phase, double seconds);
+
+    // Run the check now, or queue it for the parallel function mode
+    void dispatch(CheckStrategy& check, const clang::ast_matchers::MatchFinder::MatchResult& result);
+private:
+    struct DeferredMatch {
+        CheckStrategy* check;
+        clang::ast_matchers::MatchFinder::MatchResult result; // BoundNodes are copied, so the match outlives the callback
+        size_t end = 0;        // Its findings end here in the function's buffer, set by the worker
+        bool timedOut = false; // Set by the worker
+    };
+    struct FunctionWork {
+        const clang::FunctionDecl* function;
+        std::string sharedFunction; // AnalyzedFunctions key if this TU claimed the function
+        std::vector<DeferredMatch> matches;
+        std::vector<double> seconds; // Time of each match, filled by the worker
+        bool overBudget = false;     // Its CFG is too big, nothing was run
+        std::shared_ptr<clang::AnalysisDeclContext> prebuilt; // Built by withinBudget(), if it needed the CFG
+    };
+
+    std::vector<clang::Decl*> collectTraversalScope(clang::ASTContext& context);
+    bool isChanged(const clang::Decl* D, const clang::SourceManager& sm);
+    struct SharedFunction {
+        bool analyzedElsewhere = false; // Another TU claimed it first
+        bool claimed = false;           // This TU claimed it
+        std::string key; // AnalyzedFunctions key, empty for functions of the main file
+    };
+    SharedFunction& sharedFunction(const clang::FunctionDecl* FD, const clang::SourceManager& sm);
+    bool claimSharedFunction(SharedFunction& shared);
+    void storeResult(const clang::ASTContext& context);
+
+    struct MemoFunction {
+        std::string key;         // FunctionMemo::key(), empty if the function is not memoized
+        clang::FileID file;      // Where the function starts, MemoFinding lines are relative to it
+        unsigned firstLine = 0;
+        MemoEntry entry;         // Memo for the next run, built while the TU is analyzed
+    };
+    MemoFunction* memoFunction(const clang::FunctionDecl* FD, const clang::SourceManager& sm);
+    bool replayMemo(MemoFunction& memo, CheckStrategy& check, const clang::FunctionDecl* FD, const clang::SourceManager& sm);
+    void recordMemo(MemoFunction& memo, const std::string& check, const std::vector<Finding>& findings,
+                    const clang::SourceManager& sm);
+    void storeFunctionMemo(const clang::SourceManager& sm);
+    bool withinBudget(const clang::FunctionDecl* FD, const clang::ast_matchers::MatchFinder::MatchResult& result, bool shared);
+    void skipFunction(const clang::FunctionDecl* FD, const clang::SourceManager& sm, std::string reason);
+    void dropTimedOut(const clang::FunctionDecl* FD, const clang::SourceManager& sm, const CheckStrategy& check);
+    Deadline deadline() const;
+    void runDeferred();
+    void recordFunction(const clang::FunctionDecl* FD, double seconds, const clang::CFG* cfg);
+    void submitTimes();
+
+    llvm::StringMap<llvm::TimeRecord> matcherRecords; // MatchFinder profiling, by CheckCallback::getID()
+    clang::ast_matchers::MatchFinder finder;
+    bool limitScope = false;
+    std::vector<std::string> scopeFiles;
     unsigned count;
-    //std::unordered_set<std::string> check_names;
-    std::unordered_map<std::string, std::unique_ptr<CheckStrategy>> checks; // 存储每个检查对象
+    std::vector<std::unique_ptr<CheckStrategy>> checks; // 存储每个检查对象
+    std::vector<std::unique_ptr<CheckCallback>> callbacks; // One per registered matcher
+    bool fused = false;
+    std::vector<CheckStrategy*> walkerChecks; // Run by the walker, in AddCheck order
+    std::optional<FusedWalker> walker;        // Created with the first of them
+    AnalysisCache analysisCache; // CFGs and analyses shared by all checks of this TU
+    Arena arena;                 // Temporaries of the serial check() calls, the workers have their own
+    bool useArena = true;
+    DiagnosticEmitter emitter;   // Reports to the current TU's DiagnosticsEngine or the FindingWriter
+
+    unsigned functionJobs = 1;
+    std::unique_ptr<llvm::ThreadPool> pool; // Created on first use and kept for the following TUs
+    std::vector<FunctionWork> deferred;     // In match order
+
+    AnalyzedFunctions* analyzedFunctions = nullptr;
+    llvm::DenseMap<const clang::Decl*, SharedFunction> sharedFunctions; // By canonical decl
+
+    ResultCache* resultCache = nullptr;
+    TUResult tuResult; // Of the current TU, with a ResultCache
+
+    const ChangedLines* changedLines = nullptr;
+    llvm::DenseMap<clang::FileID, const std::vector<ChangedLines::Range>*> changedRanges; // Per file of the TU
+
+    FunctionBudget* budget = nullptr;
+    llvm::DenseMap<const clang::Decl*, bool> budgetVerdicts; // By canonical decl, false once the function is skipped
+    std::shared_ptr<clang::AnalysisDeclContext> budgetContext; // CFG of the last shared function withinBudget() checked
+    bool timedOut = false; // A check ran out of time in the TU, its result depends on the machine's load
+
+    MemoryReport* memoryReport = nullptr;
+    bool resetPeakPerTU = false;
+    TUMemory lastTUMemory;
+
+    bool useFunctionMemo = false;
+    FunctionMemo previousMemo; // Of the main file, loaded when the TU starts
+    llvm::DenseMap<const clang::Decl*, MemoFunction> memoFunctions; // By canonical decl
+    uint64_t memoHits = 0, memoMisses = 0;
+
+    TimeReport* timeReport;
+    TUTimes times;                                             // Of the current TU
+    double serialCheckSeconds = 0;                             // check() calls made from inside finder.matchAST
+    llvm::DenseMap<const clang::Decl*, size_t> functionIndex;  // Canonical decl -> times.functions
 };
 
 } // namespace myproject
 
 #endif // MATCH_CALLBACK_H
-
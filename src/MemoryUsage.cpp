@@ -0,0 +1,155 @@
+#include "MemoryUsage.h"
+#include "Log.h"
+#include <clang/Basic/SourceManager.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+#include <format>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace myproject {
+
+static double toMiB(uint64_t bytes) { return bytes / (1024.0 * 1024.0); }
+
+// Contents of a /proc file, empty if it cannot be read
+static std::string readProcFile(const char* path) {
+    auto buffer = llvm::MemoryBuffer::getFileAsStream(path);
+    return buffer ? (*buffer)->getBuffer().str() : std::string();
+}
+
+uint64_t currentRSS() {
+    // Second field of statm: resident pages
+    std::string statm = readProcFile("/proc/self/statm");
+    uint64_t pages = 0;
+    if (llvm::to_integer(llvm::StringRef(statm).split(' ').second.split(' ').first, pages))
+        return pages * llvm::sys::Process::getPageSizeEstimate();
+    return 0;
+}
+
+uint64_t peakRSS() {
+    // VmHWM follows resetPeakRSS(), ru_maxrss does not
+    std::string status = readProcFile("/proc/self/status");
+    size_t hwm = status.find("VmHWM:");
+    if (hwm != std::string::npos) {
+        llvm::StringRef value = llvm::StringRef(status).substr(hwm + 6).ltrim().split(' ').first;
+        uint64_t kib = 0;
+        if (llvm::to_integer(value, kib)) return kib * 1024;
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(__APPLE__)
+        return usage.ru_maxrss;        // Bytes
+#else
+        return usage.ru_maxrss * 1024; // KiB
+#endif
+    }
+#endif
+    return 0;
+}
+
+bool resetPeakRSS() {
+    std::error_code error;
+    llvm::raw_fd_ostream os("/proc/self/clear_refs", error, llvm::sys::fs::OF_Append);
+    if (error) return false;
+    os << "5";
+    os.close();
+    if (!os.has_error()) return true;
+    os.clear_error();
+    return false;
+}
+
+uint64_t translationUnitBytes(const clang::ASTContext& context) {
+    const clang::SourceManager& sm = context.getSourceManager();
+    clang::SourceManager::MemoryBufferSizes buffers = sm.getMemoryBufferSizes();
+    return context.getASTAllocatedMemory() + context.getSideTableAllocatedMemory() + sm.getDataStructureSizes() +
+           buffers.malloc_bytes + buffers.mmap_bytes;
+}
+
+void MemoryReport::add(TUMemory tu) {
+    MYPROJECT_LOG(LogLevel::Debug, "Memory: {}: {:.1f} MiB AST and sources, peak RSS {:.1f} MiB", tu.file,
+                  toMiB(tu.tuBytes), toMiB(tu.peakRSS));
+    std::lock_guard<std::mutex> lock(mutex);
+    units.push_back(std::move(tu));
+}
+
+void MemoryReport::logSummary(size_t max) const {
+    if (!Log::isEnabled(LogLevel::Info)) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<const TUMemory*> largest;
+    for (const TUMemory& tu : units) largest.push_back(&tu);
+    std::sort(largest.begin(), largest.end(), [](const TUMemory* a, const TUMemory* b) { return a->tuBytes > b->tuBytes; });
+
+    MYPROJECT_LOG(LogLevel::Info, "Memory: peak RSS {:.1f} MiB over {} TUs", toMiB(peakRSS()), units.size());
+    for (size_t i = 0; i < largest.size() && i < max; ++i) {
+        MYPROJECT_LOG(LogLevel::Info, "  {}: {:.1f} MiB AST and sources, peak RSS {:.1f} MiB", largest[i]->file,
+                      toMiB(largest[i]->tuBytes), toMiB(largest[i]->peakRSS));
+    }
+}
+
+MemoryLimiter::MemoryLimiter(uint64_t maxBytes)
+    : maxBytes(maxBytes), baseline(currentRSS()) {}
+
+MemoryLimiter::Ticket MemoryLimiter::acquire() {
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] {
+        if (!running) return true;
+        // Nothing is known about the size of a TU yet
+        if (!calibrated) return false;
+        if (baseline + reserved + largest > maxBytes) return false;
+        uint64_t rss = currentRSS();
+        return !rss || rss < maxBytes;
+    });
+
+    Ticket ticket;
+    ticket.reservation = largest;
+    if (running) {
+        aloneSpoiled = true;
+    } else if (resetPeakRSS()) {
+        ticket.alone = true;
+        ticket.startRSS = currentRSS();
+        aloneSpoiled = false;
+    }
+    reserved += ticket.reservation;
+    peakRunning = std::max(peakRunning, ++running);
+    return ticket;
+}
+
+void MemoryLimiter::release(const Ticket& ticket, uint64_t tuBytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        reserved -= ticket.reservation;
+        --running;
+
+        uint64_t peak = 0;
+        if (ticket.alone && !aloneSpoiled) {
+            uint64_t highWater = peakRSS();
+            peak = std::max(highWater > ticket.startRSS ? highWater - ticket.startRSS : 0, tuBytes);
+            if (peak && tuBytes) factor = std::max(factor, double(peak) / tuBytes);
+            if (peak) calibrated = true;
+        } else {
+            peak = uint64_t(tuBytes * (factor > 0 ? factor : unmeasuredFactor));
+        }
+        // Without resetPeakRSS() no TU is ever measured alone, the unmeasured factor is all there is
+        if (!ticket.alone && !running && tuBytes && !factor) calibrated = true;
+        largest = std::max(largest, peak);
+    }
+    finished.notify_all();
+}
+
+unsigned MemoryLimiter::getPeakRunning() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return peakRunning;
+}
+
+uint64_t MemoryLimiter::getLargestPeak() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return largest;
+}
+
+} // namespace myproject
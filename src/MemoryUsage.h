@@ -0,0 +1,97 @@
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <clang/AST/ASTContext.h>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace myproject {
+
+// Resident set size of the process now and its high-water mark, in bytes. 0 where it cannot be read.
+uint64_t currentRSS();
+uint64_t peakRSS();
+
+// Start a new high-water mark for peakRSS() (Linux only). Returns false if the mark cannot be reset, peakRSS()
+// is then the peak of the whole process.
+bool resetPeakRSS();
+
+// Memory held by the AST and the source buffers of a TU. For template-heavy files this is most of what
+// the TU needs at its peak, and all of it is freed with the CompilerInstance at the end of the TU.
+uint64_t translationUnitBytes(const clang::ASTContext& context);
+
+// Memory of one analyzed TU
+struct TUMemory {
+    std::string file;
+    uint64_t tuBytes = 0; // translationUnitBytes() at the end of the TU
+    uint64_t peakRSS = 0; // Of the process while it ran, including TUs analyzed at the same time
+};
+
+// The TUMemory of every TU of the run, shared by every worker
+class MemoryReport {
+public:
+    // Thread-safe, logs the TU at LogLevel::Debug
+    void add(TUMemory tu);
+
+    // Peak RSS of the run and the largest TUs, at most `max` of them, at LogLevel::Info
+    void logSummary(size_t max) const;
+
+private:
+    mutable std::mutex mutex;
+    std::vector<TUMemory> units;
+};
+
+// Limits the TUs analyzed at the same time to the ones that fit into --max-memory.
+//
+// TUs run one at a time until one of them has been measured alone: with the peak RSS reset at its start,
+// its peak over the RSS it started at is what the TU really needed (AST, Sema, preprocessor, CFGs and
+// the checks' state). That peak over the TU's translationUnitBytes() calibrates a factor, and TUs measured
+// while others ran are estimated as translationUnitBytes() times the largest factor seen. Without a way to
+// reset the peak (not Linux), the factor is unmeasuredFactor.
+//
+// Every further TU reserves the largest peak estimated so far and starts when the reservations fit into the
+// budget. One TU is always let through, so a TU larger than the budget still runs, just alone. A process
+// whose RSS already exceeds the budget starts no further TU until one finishes.
+class MemoryLimiter {
+public:
+    // What a running TU holds, from acquire() to release()
+    struct Ticket {
+        uint64_t reservation = 0;
+        bool alone = false;    // Started with no other TU running and the peak RSS reset
+        uint64_t startRSS = 0; // With `alone`
+    };
+
+    // Assumed ratio of a TU's peak to its translationUnitBytes() when no TU could be measured alone
+    static constexpr double unmeasuredFactor = 4.0;
+
+    explicit MemoryLimiter(uint64_t maxBytes);
+
+    // Block until the next TU fits
+    Ticket acquire();
+    // The TU holding `ticket` finished, `tuBytes` is its translationUnitBytes() (0 if unknown)
+    void release(const Ticket& ticket, uint64_t tuBytes);
+
+    // Largest number of TUs that ran at the same time
+    unsigned getPeakRunning() const;
+    // Largest peak measured or estimated for a TU, 0 before the first one finished
+    uint64_t getLargestPeak() const;
+
+private:
+    uint64_t maxBytes;
+    uint64_t baseline; // RSS before the first TU: the checks, the compilation database, ...
+    mutable std::mutex mutex;
+    std::condition_variable finished;
+    uint64_t reserved = 0;
+    uint64_t largest = 0;  // Largest TU peak so far, the reservation of the next TU
+    double factor = 0;     // Largest measured peak / translationUnitBytes(), 0 until a TU was measured alone
+    bool calibrated = false;
+    bool aloneSpoiled = false; // Another TU started while the one measured alone was running
+    unsigned running = 0;
+    unsigned peakRunning = 0;
+};
+
+} // namespace myproject
+
+#endif // MEMORY_USAGE_H
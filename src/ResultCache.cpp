@@ -0,0 +1,380 @@
+#include "ResultCache.h"
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/Chrono.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SHA1.h>
+#include <llvm/Support/xxhash.h>
+#include <algorithm>
+#include <chrono>
+#include <format>
+
+namespace myproject {
+
+namespace fs = llvm::sys::fs;
+
+// Bump when the entry format or the meaning of the findings changes, old entries then simply miss
+static constexpr int formatVersion = 2;
+
+// A file changed less than this many seconds before it was stored could change again within the same
+// modification time, its content hash is always checked
+static constexpr int64_t racyMTimeSeconds = 2;
+
+ResultCache::ResultCache(std::string directory, uint64_t maxBytes, std::string config, std::vector<std::string> checks)
+    : directory(std::move(directory)), maxBytes(maxBytes), config(std::move(config)), checks(std::move(checks)) {
+    if (std::error_code error = fs::create_directories(this->directory))
+        llvm::errs() << "Cannot create cache directory " << this->directory << ": " << error.message() << "\n";
+}
+
+std::string ResultCache::entryPath(llvm::StringRef key) const {
+    llvm::SmallString<256> path(directory);
+    llvm::sys::path::append(path, key + ".json");
+    return std::string(path);
+}
+
+// Hash of everything that decides the findings except the included files, which the entry lists itself
+std::optional<std::string> ResultCache::keyFor(const clang::tooling::CompileCommand& command, std::string& mainFile) const {
+    llvm::SmallString<256> path(command.Filename);
+    fs::make_absolute(command.Directory, path);
+    llvm::SmallString<256> real;
+    if (fs::real_path(path, real)) return std::nullopt;
+    mainFile = std::string(real);
+
+    auto buffer = llvm::MemoryBuffer::getFile(real);
+    if (!buffer) return std::nullopt;
+
+    llvm::SHA1 hash;
+    hash.update(std::format("v{}\n{}\n", formatVersion, config));
+    for (const auto& arg : command.CommandLine) {
+        hash.update(arg);
+        hash.update(llvm::StringRef("\0", 1));
+    }
+    hash.update(command.Directory);
+    hash.update(llvm::StringRef("\0", 1));
+    hash.update((*buffer)->getBuffer());
+    return llvm::toHex(hash.final(), /*LowerCase=*/true);
+}
+
+// A file the TU included, as it was when the TU was analyzed
+static bool isUnchanged(const llvm::json::Object& dependency) {
+    auto path = dependency.getString("path");
+    auto size = dependency.getInteger("size");
+    auto mtime = dependency.getInteger("mtime");
+    auto hash = dependency.getString("hash");
+    if (!path || !size || !mtime || !hash) return false;
+
+    fs::file_status status;
+    if (fs::status(*path, status) || static_cast<int64_t>(status.getSize()) != *size) return false;
+    if (*mtime && llvm::sys::toTimeT(status.getLastModificationTime()) == *mtime) return true;
+
+    auto buffer = llvm::MemoryBuffer::getFile(*path);
+    return buffer && llvm::utohexstr(llvm::xxHash64((*buffer)->getBuffer())) == *hash;
+}
+
+std::optional<TUResult> ResultCache::lookup(const clang::tooling::CompileCommand& command,
+                                            const AnalyzedFunctions* analyzed) {
+    std::string mainFile;
+    std::optional<std::string> key = keyFor(command, mainFile);
+    if (!key) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    auto miss = [&]() -> std::optional<TUResult> {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex);
+        pending[mainFile] = *key;
+        return std::nullopt;
+    };
+
+    std::optional<llvm::json::Value> value = readEntry(entryPath(*key));
+    if (!value) return miss();
+    const llvm::json::Object* entry = value->getAsObject();
+
+    // Every enabled check must have run when the entry was written
+    const llvm::json::Array* entryChecks = entry->getArray("checks");
+    if (!entryChecks) return miss();
+    for (const auto& check : checks) {
+        if (std::none_of(entryChecks->begin(), entryChecks->end(),
+                         [&](const llvm::json::Value& v) { return v.getAsString() == llvm::StringRef(check); }))
+            return miss();
+    }
+
+    const llvm::json::Array* dependencies = entry->getArray("dependencies");
+    if (!dependencies) return miss();
+    for (const llvm::json::Value& dependency : *dependencies) {
+        const llvm::json::Object* object = dependency.getAsObject();
+        if (!object || !isUnchanged(*object)) return miss();
+    }
+
+    // Which TU analyzes a header function depends on the order of the TUs. If the one that did is not in
+    // this run or has not come yet, the function would be reported by nobody.
+    if (const llvm::json::Array* skipped = entry->getArray("skippedFunctions")) {
+        for (const llvm::json::Value& key : *skipped) {
+            auto string = key.getAsString();
+            if (!string || !analyzed || !analyzed->isClaimed(*string)) return miss();
+        }
+    }
+
+    TUResult result;
+    result.checks = checks;
+    if (const llvm::json::Array* shared = entry->getArray("sharedFunctions")) {
+        for (const llvm::json::Value& key : *shared) {
+            if (auto string = key.getAsString()) result.sharedFunctions.push_back(string->str());
+        }
+    }
+    if (const llvm::json::Array* findings = entry->getArray("findings")) {
+        for (const llvm::json::Value& value : *findings) {
+            const llvm::json::Object* object = value.getAsObject();
+            if (!object) continue;
+            ResolvedFinding finding;
+            finding.check = object->getString("check").value_or("").str();
+            if (std::find(checks.begin(), checks.end(), finding.check) == checks.end()) continue;
+            finding.file = object->getString("file").value_or("").str();
+            finding.line = static_cast<unsigned>(object->getInteger("line").value_or(0));
+            finding.column = static_cast<unsigned>(object->getInteger("column").value_or(0));
+            finding.message = object->getString("message").value_or("").str();
+            finding.function = object->getString("function").value_or("").str();
+            finding.sharedFunction = object->getString("sharedFunction").value_or("").str();
+            result.findings.push_back(std::move(finding));
+        }
+    }
+
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return result;
+}
+
+void ResultCache::store(const clang::SourceManager& sm, TUResult result) {
+    const clang::FileEntry* mainEntry = sm.getFileEntryForID(sm.getMainFileID());
+    if (!mainEntry) return;
+
+    std::string key;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pending.find(mainEntry->tryGetRealPathName());
+        if (it == pending.end()) return; // Not looked up, e.g. a virtual file
+        key = std::move(it->second);
+        pending.erase(it);
+    }
+
+    // Every file the TU read, with the content the compiler saw
+    int64_t now = llvm::sys::toTimeT(std::chrono::system_clock::now());
+    llvm::json::Array dependencies;
+    for (auto it = sm.fileinfo_begin(); it != sm.fileinfo_end(); ++it) {
+        const clang::FileEntry* file = it->first;
+        auto buffer = it->second->getBufferIfLoaded();
+        if (!buffer) continue; // Looked up but never read
+        // Without a real path the file cannot be checked later, so the entry could never be used
+        if (file->tryGetRealPathName().empty()) return;
+        int64_t mtime = file->getModificationTime();
+        dependencies.push_back(llvm::json::Object{
+            {"path", file->tryGetRealPathName()},
+            {"size", static_cast<int64_t>(buffer->getBufferSize())},
+            {"mtime", now - mtime < racyMTimeSeconds ? 0 : mtime},
+            {"hash", llvm::utohexstr(llvm::xxHash64(buffer->getBuffer()))},
+        });
+    }
+
+    llvm::json::Array findings;
+    for (const ResolvedFinding& finding : result.findings) {
+        findings.push_back(llvm::json::Object{
+            {"check", finding.check}, {"file", finding.file}, {"line", finding.line}, {"column", finding.column},
+            {"message", finding.message}, {"function", finding.function}, {"sharedFunction", finding.sharedFunction},
+        });
+    }
+    llvm::json::Object entry{
+        {"version", formatVersion},
+        {"checks", llvm::json::Array(result.checks)},
+        {"dependencies", std::move(dependencies)},
+        {"sharedFunctions", llvm::json::Array(result.sharedFunctions)},
+        {"skippedFunctions", llvm::json::Array(result.skippedFunctions)},
+        {"findings", std::move(findings)},
+    };
+
+    writeEntry(entryPath(key), std::move(entry));
+}
+
+// Other processes may read or write the same entry, so it only appears once it is complete
+void ResultCache::writeEntry(const std::string& path, llvm::json::Value value) const {
+    int fd;
+    llvm::SmallString<256> model(directory);
+    llvm::sys::path::append(model, "entry-%%%%%%%%.tmp");
+    llvm::SmallString<256> temporary;
+    if (fs::createUniqueFile(model, fd, temporary)) return;
+    {
+        llvm::raw_fd_ostream os(fd, /*shouldClose=*/true);
+        os << value;
+        os.close();
+        if (os.has_error()) {
+            os.clear_error();
+            fs::remove(temporary);
+            return;
+        }
+    }
+    if (fs::rename(temporary, path)) fs::remove(temporary);
+}
+
+// The entry at `path` if it exists, parses and has the current version. Marks it as recently used for prune().
+std::optional<llvm::json::Value> ResultCache::readEntry(const std::string& path) const {
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (!buffer) return std::nullopt;
+    llvm::Expected<llvm::json::Value> value = llvm::json::parse((*buffer)->getBuffer());
+    if (!value) {
+        llvm::consumeError(value.takeError());
+        return std::nullopt;
+    }
+    const llvm::json::Object* entry = value->getAsObject();
+    if (!entry || entry->getInteger("version") != formatVersion) return std::nullopt;
+
+    // Failing to touch the entry only makes it older
+    int fd;
+    if (!fs::openFileForWrite(path, fd, fs::CD_OpenExisting, fs::OF_Append)) {
+        fs::setLastAccessAndModificationTime(fd, std::chrono::system_clock::now());
+        fs::file_t file = fs::convertFDToNativeFile(fd);
+        fs::closeFile(file);
+    }
+    return std::move(*value);
+}
+
+// One file per main file, next to the TU entries and pruned with them
+std::string ResultCache::functionMemoPath(const clang::SourceManager& sm) const {
+    const clang::FileEntry* mainEntry = sm.getFileEntryForID(sm.getMainFileID());
+    if (!mainEntry || mainEntry->tryGetRealPathName().empty()) return {};
+
+    llvm::SHA1 hash;
+    hash.update(std::format("v{}\n{}\n", formatVersion, config));
+    hash.update(mainEntry->tryGetRealPathName());
+    return entryPath(llvm::toHex(hash.final(), /*LowerCase=*/true) + ".functions");
+}
+
+FunctionMemo ResultCache::loadFunctionMemo(const clang::SourceManager& sm) const {
+    FunctionMemo memo;
+    std::string path = functionMemoPath(sm);
+    if (path.empty()) return memo;
+    std::optional<llvm::json::Value> value = readEntry(path);
+    const llvm::json::Object* functions = value ? value->getAsObject()->getObject("functions") : nullptr;
+    if (!functions) return memo;
+
+    for (const auto& [key, function] : *functions) {
+        const llvm::json::Object* object = function.getAsObject();
+        const llvm::json::Array* checks = object ? object->getArray("checks") : nullptr;
+        const llvm::json::Array* findings = object ? object->getArray("findings") : nullptr;
+        if (!checks || !findings) continue;
+
+        MemoEntry entry;
+        for (const llvm::json::Value& check : *checks) {
+            if (auto name = check.getAsString()) entry.checks.push_back(name->str());
+        }
+        for (const llvm::json::Value& finding : *findings) {
+            const llvm::json::Object* f = finding.getAsObject();
+            if (!f) continue;
+            MemoFinding memoFinding{f->getString("check").value_or("").str(),
+                                    static_cast<unsigned>(f->getInteger("line").value_or(0)),
+                                    static_cast<unsigned>(f->getInteger("column").value_or(0)),
+                                    f->getString("message").value_or("").str()};
+            if (auto relatedLine = f->getInteger("relatedLine")) {
+                memoFinding.hasRelated = true;
+                memoFinding.relatedLine = static_cast<unsigned>(*relatedLine);
+                memoFinding.relatedColumn = static_cast<unsigned>(f->getInteger("relatedColumn").value_or(0));
+            }
+            entry.findings.push_back(std::move(memoFinding));
+        }
+        memo.functions[key.str()] = std::move(entry);
+    }
+    return memo;
+}
+
+void ResultCache::storeFunctionMemo(const clang::SourceManager& sm, const FunctionMemo& memo) const {
+    std::string path = functionMemoPath(sm);
+    if (path.empty()) return;
+
+    llvm::json::Object functions;
+    for (const auto& function : memo.functions) {
+        llvm::json::Array findings;
+        for (const MemoFinding& finding : function.second.findings) {
+            llvm::json::Object object{{"check", finding.check}, {"line", finding.line},
+                                      {"column", finding.column}, {"message", finding.message}};
+            if (finding.hasRelated) {
+                object["relatedLine"] = finding.relatedLine;
+                object["relatedColumn"] = finding.relatedColumn;
+            }
+            findings.push_back(std::move(object));
+        }
+        functions[function.first()] = llvm::json::Object{{"checks", llvm::json::Array(function.second.checks)},
+                                                         {"findings", std::move(findings)}};
+    }
+    writeEntry(path, llvm::json::Object{{"version", formatVersion}, {"functions", std::move(functions)}});
+}
+
+void ResultCache::countFunctionMemo(uint64_t hits, uint64_t misses) {
+    functionHits.fetch_add(hits, std::memory_order_relaxed);
+    functionMisses.fetch_add(misses, std::memory_order_relaxed);
+}
+
+void ResultCache::replay(const TUResult& result, AnalyzedFunctions* analyzed, FindingWriter* writer, llvm::raw_ostream& os) {
+    // Claim the header functions like the TU would have. A function some other TU has analyzed in this run
+    // has been reported there already; one claimed here will be skipped by the TUs that follow.
+    llvm::StringMap<bool> claimed;
+    if (analyzed) {
+        for (const auto& key : result.sharedFunctions) claimed[key] = analyzed->claim(key);
+    }
+
+    std::string batch;
+    for (const ResolvedFinding& finding : result.findings) {
+        if (analyzed && !finding.sharedFunction.empty()) {
+            auto [it, inserted] = claimed.try_emplace(finding.sharedFunction, false);
+            if (inserted) it->second = analyzed->claim(finding.sharedFunction);
+            if (!it->second) continue;
+        }
+        if (writer) {
+            writer->formatRecord(batch, finding);
+        } else if (finding.file.empty()) {
+            os << std::format("warning: {} [{}]\n", finding.message, finding.check);
+        } else {
+            os << std::format("{}:{}:{}: warning: {} [{}]\n", finding.file, finding.line, finding.column,
+                              finding.message, finding.check);
+        }
+    }
+    if (writer) writer->write(batch);
+}
+
+// Entries are ordered by their modification time, which lookup() refreshes on every hit. Concurrent
+// processes may prune at the same time; at worst a few more entries than needed go away.
+void ResultCache::prune() {
+    struct Entry {
+        std::string path;
+        uint64_t size;
+        llvm::sys::TimePoint<> used;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    auto now = std::chrono::system_clock::now();
+
+    std::error_code error;
+    for (fs::directory_iterator it(directory, error), end; it != end && !error; it.increment(error)) {
+        fs::file_status status;
+        if (fs::status(it->path(), status)) continue;
+        llvm::StringRef extension = llvm::sys::path::extension(it->path());
+        if (extension == ".tmp") {
+            // Left behind by a process that died while writing
+            if (now - status.getLastModificationTime() > std::chrono::hours(1)) fs::remove(it->path());
+            continue;
+        }
+        if (extension != ".json") continue;
+        entries.push_back({it->path(), status.getSize(), status.getLastModificationTime()});
+        total += status.getSize();
+    }
+    if (total <= maxBytes) return;
+
+    // Go down to 90% of the limit, so the next runs do not have to prune again right away
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    uint64_t target = maxBytes / 10 * 9;
+    for (const Entry& entry : entries) {
+        if (total <= target) break;
+        if (!fs::remove(entry.path)) total -= entry.size;
+    }
+}
+
+} // namespace myproject
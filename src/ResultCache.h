@@ -0,0 +1,90 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <clang/Basic/SourceManager.h>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include "AnalyzedFunctions.h"
+#include "Findings.h"
+#include "FunctionMemo.h"
+
+namespace myproject {
+
+// What a TU produced, as stored in the cache
+struct TUResult {
+    std::vector<std::string> checks;          // Checks that ran, the findings of every other check are unknown
+    std::vector<std::string> sharedFunctions; // AnalyzedFunctions keys claimed by the TU
+    std::vector<std::string> skippedFunctions; // Keys another TU had claimed, their findings are not in `findings`
+    std::vector<ResolvedFinding> findings;
+};
+
+// On-disk cache of the findings of whole TUs, shared by runs and by concurrent tool processes (--cache-dir).
+//
+// An entry is found by a hash of the compile command, the tool configuration and the main file, and it
+// lists every file the TU included with its size, modification time and content hash. It is used when
+// none of them changed, so an unchanged TU is answered without parsing it. Entries are written to a
+// temporary file and renamed into place, readers never see a partial entry.
+class ResultCache {
+public:
+    // `config` holds every option that changes the findings apart from the enabled checks
+    ResultCache(std::string directory, uint64_t maxBytes, std::string config, std::vector<std::string> checks);
+
+    // The cached result of the TU built by `command`, restricted to the enabled checks. Thread-safe.
+    // A miss remembers the key, so the result can be stored once the TU has been analyzed.
+    // A result that left header functions to other TUs is complete only together with theirs: it is used
+    // when every one of those functions has already been claimed in this run (in `analyzed`).
+    std::optional<TUResult> lookup(const clang::tooling::CompileCommand& command, const AnalyzedFunctions* analyzed);
+
+    // Store the result of a TU that missed, called with its SourceManager at the end of the TU. Thread-safe.
+    void store(const clang::SourceManager& sm, TUResult result);
+
+    // Report a cached result like the TU would have: to the writer if there is one, otherwise as
+    // warnings on `os`. Header functions already analyzed in this run are left out.
+    static void replay(const TUResult& result, AnalyzedFunctions* analyzed, FindingWriter* writer, llvm::raw_ostream& os);
+
+    // The function memo of the TU's main file from the last run that analyzed it, empty if there is none
+    FunctionMemo loadFunctionMemo(const clang::SourceManager& sm) const;
+    // Replace the function memo of the TU's main file
+    void storeFunctionMemo(const clang::SourceManager& sm, const FunctionMemo& memo) const;
+    // Functions answered from / missing in the function memos, for the hit rate
+    void countFunctionMemo(uint64_t hits, uint64_t misses);
+
+    // Remove the least recently used entries until the cache fits into its size limit again
+    void prune();
+
+    uint64_t getHits() const { return hits.load(std::memory_order_relaxed); }
+    uint64_t getMisses() const { return misses.load(std::memory_order_relaxed); }
+    uint64_t getFunctionHits() const { return functionHits.load(std::memory_order_relaxed); }
+    uint64_t getFunctionMisses() const { return functionMisses.load(std::memory_order_relaxed); }
+
+private:
+    std::optional<std::string> keyFor(const clang::tooling::CompileCommand& command, std::string& mainFile) const;
+    std::string entryPath(llvm::StringRef key) const;
+    std::string functionMemoPath(const clang::SourceManager& sm) const;
+    void writeEntry(const std::string& path, llvm::json::Value value) const;
+    std::optional<llvm::json::Value> readEntry(const std::string& path) const;
+
+    std::string directory;
+    uint64_t maxBytes;
+    std::string config;
+    std::vector<std::string> checks;
+
+    std::mutex mutex;
+    llvm::StringMap<std::string> pending; // Real path of a main file that missed -> its key
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> functionHits{0};
+    std::atomic<uint64_t> functionMisses{0};
+};
+
+} // namespace myproject
+
+#endif // RESULT_CACHE_H
@@ -0,0 +1,92 @@
+#include "TimeReport.h"
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+
+namespace myproject {
+
+namespace {
+
+void keepSlowest(std::vector<FunctionTime>& functions, size_t count) {
+    count = std::min(count, functions.size());
+    std::partial_sort(functions.begin(), functions.begin() + count, functions.end(),
+                      [](const FunctionTime& a, const FunctionTime& b) { return a.seconds > b.seconds; });
+    functions.resize(count);
+}
+
+void writeStats(llvm::json::OStream& json, llvm::StringRef key, const std::map<std::string, TimeStat>& stats) {
+    json.attributeObject(key, [&] {
+        for (const auto& [name, stat] : stats) {
+            json.attributeObject(name, [&] {
+                json.attribute("seconds", stat.seconds);
+                json.attribute("calls", static_cast<int64_t>(stat.calls));
+            });
+        }
+    });
+}
+
+} // namespace
+
+void TimeReport::add(TUTimes times) {
+    keepSlowest(times.functions, slowestFunctions);
+    std::lock_guard<std::mutex> lock(mutex);
+    units.push_back(std::move(times));
+}
+
+bool TimeReport::write(llvm::StringRef path) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::error_code error;
+    llvm::raw_fd_ostream os(path, error, llvm::sys::fs::OF_Text);
+    if (error) {
+        llvm::errs() << "Cannot write time report " << path << ": " << error.message() << "\n";
+        return false;
+    }
+
+    TUTimes total;
+    std::vector<FunctionTime> slowest;
+    for (const TUTimes& unit : units) {
+        for (const auto& [name, stat] : unit.phases) total.phases[name].add(stat);
+        for (const auto& [name, stat] : unit.checks) total.checks[name].add(stat);
+        for (const auto& [name, stat] : unit.matchers) total.matchers[name].add(stat);
+        slowest.insert(slowest.end(), unit.functions.begin(), unit.functions.end());
+    }
+    keepSlowest(slowest, slowestFunctions);
+
+    llvm::json::OStream json(os, 2);
+    json.object([&] {
+        json.attributeObject("total", [&] {
+            json.attribute("translationUnits", static_cast<int64_t>(units.size()));
+            writeStats(json, "phases", total.phases);
+            writeStats(json, "checks", total.checks);
+            writeStats(json, "matchers", total.matchers);
+        });
+        json.attributeArray("translationUnits", [&] {
+            for (const TUTimes& unit : units) {
+                json.object([&] {
+                    json.attribute("file", unit.file);
+                    json.attribute("tuBytes", static_cast<int64_t>(unit.tuBytes));
+                    json.attribute("peakRSSBytes", static_cast<int64_t>(unit.peakRSS));
+                    writeStats(json, "phases", unit.phases);
+                    writeStats(json, "checks", unit.checks);
+                    writeStats(json, "matchers", unit.matchers);
+                });
+            }
+        });
+        json.attributeArray("slowestFunctions", [&] {
+            for (const FunctionTime& function : slowest) {
+                json.object([&] {
+                    json.attribute("function", function.function);
+                    json.attribute("file", function.file);
+                    json.attribute("seconds", function.seconds);
+                    json.attribute("cfgBlocks", static_cast<int64_t>(function.cfgBlocks));
+                });
+            }
+        });
+    });
+    os << "\n";
+    return true;
+}
+
+} // namespace myproject
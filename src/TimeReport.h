@@ -0,0 +1,75 @@
+#ifndef TIME_REPORT_H
+#define TIME_REPORT_H
+
+#include <llvm/ADT/StringRef.h>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace myproject {
+
+// Wall time and number of calls of one measured item
+struct TimeStat {
+    double seconds = 0;
+    uint64_t calls = 0;
+
+    void add(double s, uint64_t n = 1) {
+        seconds += s;
+        calls += n;
+    }
+    void add(const TimeStat& other) { add(other.seconds, other.calls); }
+};
+
+// Wall clock started on construction
+class Stopwatch {
+public:
+    Stopwatch() : start(std::chrono::steady_clock::now()) {}
+    double seconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+// Time the checks spent on one function, for the list of slowest functions
+struct FunctionTime {
+    std::string file;       // Main file of the TU
+    std::string function;   // Qualified name
+    double seconds = 0;     // CFG construction and all checks
+    unsigned cfgBlocks = 0;
+};
+
+// Timings of one TU. Filled by the MyMatchCallback handling the TU, without locking.
+struct TUTimes {
+    std::string file;
+    std::map<std::string, TimeStat> phases;   // parse, match, cfg, checks
+    std::map<std::string, TimeStat> checks;   // By CheckStrategy::getName()
+    std::map<std::string, TimeStat> matchers; // By matcher ID, "<check>[<index>]"
+    std::vector<FunctionTime> functions;
+    uint64_t tuBytes = 0; // See TUMemory
+    uint64_t peakRSS = 0;
+};
+
+// Collects the TUTimes of every worker and writes them as JSON for --time-report
+class TimeReport {
+public:
+    explicit TimeReport(unsigned slowestFunctions) : slowestFunctions(slowestFunctions) {}
+
+    // Thread-safe. Only the slowest functions of the TU are kept.
+    void add(TUTimes times);
+
+    // Totals, every TU and the slowest functions overall. Returns false if the file cannot be written.
+    bool write(llvm::StringRef path) const;
+
+private:
+    unsigned slowestFunctions;
+    mutable std::mutex mutex;
+    std::vector<TUTimes> units;
+};
+
+} // namespace myproject
+
+#endif // TIME_REPORT_H
@@ -0,0 +1,302 @@
+#pragma once
+
+#include "CheckStrategies.h"
+#include "CheckRegistry.h"
+#include "clang/ASTMatchers/ASTMatchers.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include <clang/Analysis/CFG.h>
+#include <clang/AST/ParentMap.h>
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
+#include <algorithm>
+#include <format>
+#include <string>
+#include <optional>
+#include <vector>
+
+// Reports reads of local variables that are not initialized on every path leading to them.
+// A forward must-initialized dataflow over the function CFG: one bit per tracked variable, the
+// state of a block entry is the intersection of its predecessors' exit states.
+class UninitializedVariableCheck : public CheckStrategy, public myproject::FunctionVisitor {
+public:
+UninitializedVariableCheck(const std::string& name) : CheckStrategy(name) {}
+
+MatchersList getMatchers() const final {
+    using namespace clang::ast_matchers;
+
+    MatchersList matchers;
+    matchers.declarations.push_back(functionDecl(isExpansionInMainFile(), hasBody(stmt())).bind("uninit_func"));
+
+    return matchers;
+}
+
+    std::optional<bool> check(const clang::ast_matchers::MatchFinder::MatchResult& result, myproject::CheckContext& context) final;
+
+    // All the dataflow state is local to check(), only the function's own CFG is read
+    const clang::FunctionDecl* analyzedFunction(const clang::ast_matchers::MatchFinder::MatchResult& result) const final {
+        return result.Nodes.getNodeAs<clang::FunctionDecl>("uninit_func");
+    }
+
+    const myproject::FunctionVisitor* getFunctionVisitor() const final { return this; }
+    llvm::StringRef getFunctionBinding() const final { return "uninit_func"; }
+    Interest interest(const clang::FunctionDecl* FD, const clang::SourceManager& sm) const final {
+        return sm.isInMainFile(sm.getExpansionLoc(FD->getBeginLoc())) ? Interest::Yes : Interest::No;
+    }
+
+private:
+    // What one CFG element does to a tracked variable, in evaluation order
+    enum class Effect { Initialize, Uninitialize, Read };
+    struct Event {
+        unsigned id;
+        Effect effect;
+        const clang::DeclRefExpr* use; // Set for reads
+    };
+
+    // The events of every block plus its gen/kill summary. The events of all blocks share one array, a block
+    // owns the range [begin, end) of it, so collecting them costs no allocation per block.
+    struct FunctionEvents {
+        explicit FunctionEvents(myproject::Arena* arena) : events(arena), ranges(arena), gen(arena), kill(arena) {}
+        llvm::ArrayRef<Event> block(unsigned id) const {
+            return llvm::ArrayRef<Event>(events).slice(ranges[id].first, ranges[id].second - ranges[id].first);
+        }
+
+        myproject::ArenaVector<Event> events;
+        myproject::ArenaVector<std::pair<unsigned, unsigned>> ranges; // By block ID
+        myproject::ArenaVector<llvm::BitVector> gen, kill;
+    };
+
+    unsigned collectVariables(const clang::CFG& cfg, llvm::DenseMap<const clang::VarDecl*, unsigned>& ids) const;
+    FunctionEvents collectEvents(const clang::CFG& cfg, const clang::ParentMap& PM,
+                                 const llvm::DenseMap<const clang::VarDecl*, unsigned>& ids, myproject::Arena* arena) const;
+    std::optional<bool> reportUninitializedUse(const clang::DeclRefExpr* use, myproject::FindingSink& findings,
+                                               const clang::FunctionDecl* FD) const;
+};
+
+inline const myproject::RegisterCheck<UninitializedVariableCheck> registerUninitializedVariableCheck("uninitialized-variable");
+
+std::optional<bool> UninitializedVariableCheck::check(const clang::ast_matchers::MatchFinder::MatchResult& result, myproject::CheckContext& context) {
+    const auto* FD = result.Nodes.getNodeAs<clang::FunctionDecl>("uninit_func");
+    if (!FD || !FD->hasBody()) return false;
+
+    clang::AnalysisDeclContext *AC = context.cache.getContext(FD, *result.Context);
+    const clang::CFG *cfg = AC ? AC->getCFG() : nullptr;
+    if (!cfg) {
+        llvm::errs() << "Could not generate CFG for function.\n";
+        return false;
+    }
+
+    // Number the variables that can be read before they are written, most functions have none
+    llvm::DenseMap<const clang::VarDecl*, unsigned> ids;
+    unsigned numVars = collectVariables(*cfg, ids);
+    if (!numVars) return true;
+
+    FunctionEvents events = collectEvents(*cfg, AC->getParentMap(), ids, context.arena);
+    unsigned numBlocks = cfg->getNumBlockIDs();
+
+    // Reverse postorder from the entry, blocks that are not reached keep the "everything initialized" state
+    myproject::ArenaVector<const clang::CFGBlock*> rpo(context.arena);
+    {
+        llvm::BitVector visited(numBlocks);
+        myproject::ArenaVector<std::pair<const clang::CFGBlock*, clang::CFGBlock::const_succ_iterator>> stack(context.arena);
+        const clang::CFGBlock* entry = &cfg->getEntry();
+        visited.set(entry->getBlockID());
+        stack.push_back({entry, entry->succ_begin()});
+        while (!stack.empty()) {
+            const clang::CFGBlock* block = stack.back().first;
+            auto& it = stack.back().second;
+            if (it == block->succ_end()) {
+                rpo.push_back(block);
+                stack.pop_back();
+                continue;
+            }
+            const clang::CFGBlock* succ = *it++;
+            if (succ && !visited.test(succ->getBlockID())) {
+                visited.set(succ->getBlockID());
+                stack.push_back({succ, succ->succ_begin()});
+            }
+        }
+        std::reverse(rpo.begin(), rpo.end());
+    }
+
+    // out = (in & ~kill) | gen, in = AND of the predecessors' out, iterated in RPO until nothing changes
+    myproject::ArenaVector<llvm::BitVector> in(numBlocks, llvm::BitVector(numVars, true), context.arena);
+    myproject::ArenaVector<llvm::BitVector> out(numBlocks, llvm::BitVector(numVars, true), context.arena);
+    llvm::BitVector value(numVars);
+    bool changed = true;
+    while (changed) {
+        if (context.deadline.expired()) return false;
+        changed = false;
+        for (const clang::CFGBlock* block : rpo) {
+            unsigned id = block->getBlockID();
+            if (block == &cfg->getEntry()) {
+                value.reset();
+            } else {
+                value.set();
+                for (const clang::CFGBlock* pred : block->preds()) {
+                    if (pred) value &= out[pred->getBlockID()];
+                }
+            }
+            in[id] = value;
+            value.reset(events.kill[id]);
+            value |= events.gen[id];
+            if (value != out[id]) {
+                out[id] = value;
+                changed = true;
+            }
+        }
+    }
+
+    // Replay the reachable blocks and collect the reads that may see an uninitialized value
+    myproject::ArenaVector<const Event*> uses(context.arena);
+    for (const clang::CFGBlock* block : rpo) {
+        value = in[block->getBlockID()];
+        for (const Event& event : events.block(block->getBlockID())) {
+            switch (event.effect) {
+            case Effect::Initialize: value.set(event.id); break;
+            case Effect::Uninitialize: value.reset(event.id); break;
+            case Effect::Read:
+                if (!value.test(event.id)) uses.push_back(&event);
+                break;
+            }
+        }
+    }
+
+    // Report the first such read of each variable, in source order like the other checks. check() may run on a
+    // worker that must not use the SourceManager, so the order is the position in a pre-order walk of the body:
+    // the AST keeps children in the order they are written.
+    llvm::DenseMap<const clang::Stmt*, unsigned> position;
+    for (const Event* use : uses) position.try_emplace(use->use, 0);
+    if (position.size() > 1) {
+        unsigned next = 0;
+        myproject::ArenaVector<const clang::Stmt*> stack(context.arena);
+        stack.push_back(FD->getBody());
+        while (!stack.empty()) {
+            const clang::Stmt* S = stack.back();
+            stack.pop_back();
+            if (!S) continue;
+            if (auto it = position.find(S); it != position.end()) it->second = ++next;
+            size_t first = stack.size();
+            for (const clang::Stmt* child : S->children()) stack.push_back(child);
+            std::reverse(stack.begin() + first, stack.end());
+        }
+    }
+    std::stable_sort(uses.begin(), uses.end(), [&position](const Event* a, const Event* b) {
+        return position.lookup(a->use) < position.lookup(b->use);
+    });
+    llvm::BitVector reported(numVars);
+    for (const Event* use : uses) {
+        if (reported.test(use->id)) continue;
+        reported.set(use->id);
+        reportUninitializedUse(use->use, context.findings, FD);
+    }
+    return true;
+}
+
+// Locals declared without an initializer whose value can be read: scalars that are not static or references
+unsigned UninitializedVariableCheck::collectVariables(const clang::CFG& cfg, llvm::DenseMap<const clang::VarDecl*, unsigned>& ids) const {
+    for (const clang::CFGBlock* block : cfg) {
+        for (const clang::CFGElement& element : *block) {
+            auto S = element.getAs<clang::CFGStmt>();
+            if (!S) continue;
+            const auto* DS = llvm::dyn_cast<clang::DeclStmt>(S->getStmt());
+            if (!DS) continue;
+            for (const clang::Decl* D : DS->decls()) {
+                const auto* VD = llvm::dyn_cast<clang::VarDecl>(D);
+                if (!VD || !VD->hasLocalStorage() || VD->hasInit() || VD->isExceptionVariable()) continue;
+                if (!VD->getType()->isScalarType()) continue;
+                ids.try_emplace(VD, static_cast<unsigned>(ids.size()));
+            }
+        }
+    }
+    return static_cast<unsigned>(ids.size());
+}
+
+// A DeclRefExpr of a tracked variable is a read when it is loaded (lvalue-to-rvalue), and a read followed by a
+// write when it is modified in place (compound assignment, increment, decrement). Any other use that is not the
+// left hand side of a plain assignment (address taken, bound to a reference, ...) may initialize it.
+UninitializedVariableCheck::FunctionEvents UninitializedVariableCheck::collectEvents(
+        const clang::CFG& cfg, const clang::ParentMap& PM, const llvm::DenseMap<const clang::VarDecl*, unsigned>& ids,
+        myproject::Arena* arena) const {
+    unsigned numBlocks = cfg.getNumBlockIDs();
+    unsigned numVars = static_cast<unsigned>(ids.size());
+    FunctionEvents events(arena);
+    events.ranges.assign(numBlocks, {0, 0});
+    events.gen.assign(numBlocks, llvm::BitVector(numVars));
+    events.kill.assign(numBlocks, llvm::BitVector(numVars));
+
+    auto lookup = [&ids](const clang::Decl* D) -> std::optional<unsigned> {
+        const auto* VD = llvm::dyn_cast<clang::VarDecl>(D);
+        auto it = VD ? ids.find(VD) : ids.end();
+        if (it == ids.end()) return std::nullopt;
+        return it->second;
+    };
+
+    for (const clang::CFGBlock* block : cfg) {
+        auto& list = events.events;
+        unsigned begin = static_cast<unsigned>(list.size());
+        for (const clang::CFGElement& element : *block) {
+            auto CS = element.getAs<clang::CFGStmt>();
+            if (!CS) continue;
+            const clang::Stmt* S = CS->getStmt();
+
+            if (const auto* DS = llvm::dyn_cast<clang::DeclStmt>(S)) {
+                // Entering the scope again (e.g. in a loop body) makes the variable uninitialized
+                for (const clang::Decl* D : DS->decls()) {
+                    if (auto id = lookup(D)) list.push_back({*id, Effect::Uninitialize, nullptr});
+                }
+            } else if (const auto* BO = llvm::dyn_cast<clang::BinaryOperator>(S)) {
+                // The left hand side is evaluated before the assignment itself shows up in the block
+                if (BO->getOpcode() != clang::BO_Assign) continue;
+                const auto* DR = llvm::dyn_cast<clang::DeclRefExpr>(BO->getLHS()->IgnoreParens());
+                if (!DR) continue;
+                if (auto id = lookup(DR->getDecl())) list.push_back({*id, Effect::Initialize, nullptr});
+            } else if (const auto* DR = llvm::dyn_cast<clang::DeclRefExpr>(S)) {
+                auto id = lookup(DR->getDecl());
+                if (!id) continue;
+                const clang::Stmt* parent = PM.getParentIgnoreParens(DR);
+                const auto* cast = llvm::dyn_cast_or_null<clang::ImplicitCastExpr>(parent);
+                if (cast && cast->getCastKind() == clang::CK_LValueToRValue) {
+                    list.push_back({*id, Effect::Read, DR});
+                    continue;
+                }
+                const auto* assignment = llvm::dyn_cast_or_null<clang::BinaryOperator>(parent);
+                if (assignment && assignment->getOpcode() == clang::BO_Assign &&
+                    assignment->getLHS()->IgnoreParens() == DR)
+                    continue;
+                // x += 1, ++x and x++ load the old value before they store the new one
+                const auto* unary = llvm::dyn_cast_or_null<clang::UnaryOperator>(parent);
+                if ((assignment && assignment->isCompoundAssignmentOp() && assignment->getLHS()->IgnoreParens() == DR) ||
+                    (unary && unary->isIncrementDecrementOp()))
+                    list.push_back({*id, Effect::Read, DR});
+                list.push_back({*id, Effect::Initialize, nullptr});
+            }
+        }
+
+        events.ranges[block->getBlockID()] = {begin, static_cast<unsigned>(list.size())};
+
+        // Fold the block into its gen/kill summary
+        llvm::BitVector& gen = events.gen[block->getBlockID()];
+        llvm::BitVector& kill = events.kill[block->getBlockID()];
+        for (const Event& event : events.block(block->getBlockID())) {
+            if (event.effect == Effect::Initialize) {
+                gen.set(event.id);
+                kill.reset(event.id);
+            } else if (event.effect == Effect::Uninitialize) {
+                kill.set(event.id);
+                gen.reset(event.id);
+            }
+        }
+    }
+    return events;
+}
+
+std::optional<bool> UninitializedVariableCheck::reportUninitializedUse(const clang::DeclRefExpr* use, myproject::FindingSink& findings,
+                                                                      const clang::FunctionDecl* FD) const {
+    if (!use) return std::nullopt;
+
+    findings.report({getName(), use->getLocation(),
+                     std::format("Variable '{}' may be uninitialized when used here", use->getDecl()->getName().str()),
+                     FD->getQualifiedNameAsString()});
+    return true;
+}
@@ -1,134 +1,117 @@
 #pragma once
 
 #include "CheckStrategies.h"
+#include "CheckRegistry.h"
+#include "BlockReachability.h"
 #include "clang/ASTMatchers/ASTMatchers.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 #include <clang/Analysis/CFG.h>
+#include <clang/AST/ParentMap.h>
 #include "llvm/Support/raw_ostream.h"
-#include <format>
 #include <string>
 #include <optional>
 #include <assert.h>
-#include <queue>
 
-class UnreachableCodeCheck : public CheckStrategy {
-public:
+namespace myproject {
+// The name of the function is spelled in the main file, not in a header or a macro. Decided while matching,
+// on the thread that owns the SourceManager; check() may run on a worker that must not touch it.
+AST_MATCHER(clang::FunctionDecl, isNameWrittenInMainFile) {
+    return Finder->getASTContext().getSourceManager().isWrittenInMainFile(Node.getLocation());
+}
+} // namespace myproject
 
-typedef llvm::SmallSet<unsigned, 32> CFG_Set;
+class UnreachableCodeCheck : public CheckStrategy, public myproject::FunctionVisitor {
+public:
 
-UnreachableCodeCheck(const std::string& name) : CheckStrategy(name) {
-    unreachableBlocks.reserve(16);    
-}
+UnreachableCodeCheck(const std::string& name) : CheckStrategy(name) {}
 
 MatchersList getMatchers() const final {
     using namespace clang::ast_matchers;
-    using cadv = clang::ast_matchers::dynamic::VariantMatcher;
     
     MatchersList matchers;
-    matchers.push_back(cadv::SingleMatcher(functionDecl(hasBody(stmt())).bind("unreachable_func")));
+    matchers.declarations.push_back(functionDecl(myproject::isNameWrittenInMainFile(), hasBody(stmt())).bind("unreachable_func"));
     
     return matchers;
 }
 
-    std::optional<bool> check(const clang::ast_matchers::MatchFinder::MatchResult& result) final;
+    std::optional<bool> check(const clang::ast_matchers::MatchFinder::MatchResult& result, myproject::CheckContext& context) final;
+
+    // Works on the function's own CFG only, the reachability engine is per thread so functions can run in parallel.
+    // Called on the main thread, the matcher and interest() already left out functions outside the main file.
+    const clang::FunctionDecl* analyzedFunction(const clang::ast_matchers::MatchFinder::MatchResult& result) const final {
+        return result.Nodes.getNodeAs<clang::FunctionDecl>("unreachable_func");
+    }
+
+    // Same filter as the matcher
+    const myproject::FunctionVisitor* getFunctionVisitor() const final { return this; }
+    llvm::StringRef getFunctionBinding() const final { return "unreachable_func"; }
+    Interest interest(const clang::FunctionDecl* FD, const clang::SourceManager& sm) const final {
+        return sm.isWrittenInMainFile(FD->getLocation()) ? Interest::Yes : Interest::No;
+    }
 private:
-    CFG_Set reachable, visited;
-    std::vector<const clang::CFGBlock*> unreachableBlocks;
-    std::optional<bool> reportUnreachableCode(const clang::Stmt* stmt, const clang::SourceManager& sm);
-    const clang::Stmt* getUnreachableStmt(const clang::CFGBlock *Block);
-    std::optional<bool> markReachableBlocks(const clang::CFG *cfg, CFG_Set &reachable);
+    std::optional<bool> reportUnreachableCode(const clang::Stmt* stmt, myproject::FindingSink& findings,
+                                              const clang::FunctionDecl* FD);
+    const clang::Stmt* getUnreachableStmt(const clang::CFGBlock *Block, const clang::ParentMap &PM);
 };
 
-std::optional<bool> UnreachableCodeCheck::check(const clang::ast_matchers::MatchFinder::MatchResult& result) {
-    const clang::SourceManager& sm = *result.SourceManager;
+inline const myproject::RegisterCheck<UnreachableCodeCheck> registerUnreachableCodeCheck("unreachable-code");
+
+std::optional<bool> UnreachableCodeCheck::check(const clang::ast_matchers::MatchFinder::MatchResult& result, myproject::CheckContext& context) {
+    // Only functions of the main file are matched, no SourceManager lookups here
     if (const clang::FunctionDecl* FD = result.Nodes.getNodeAs<clang::FunctionDecl>("unreachable_func")) {
-        if (!sm.isWrittenInMainFile(FD->getLocation())) {
-            return {}; 
-        }
-        // Generate the control flow graph (CFG)
-        std::unique_ptr<clang::CFG> cfg = clang::CFG::buildCFG(FD, FD->getBody(), 
-                                                               result.Context, clang::CFG::BuildOptions());
+        // Get the control flow graph (CFG) shared with the other checks
+        clang::AnalysisDeclContext *AC = context.cache.getContext(FD, *result.Context);
+        const clang::CFG *cfg = AC ? AC->getCFG() : nullptr;
         assert(cfg != nullptr && "Failed to generate CFG for function");
 
-        // Mark reachable blocks
-        auto reachableResult = markReachableBlocks(cfg.get(), reachable);
-        if (!reachableResult.has_value()) {
-            llvm::outs() << "No reachable blocks found\n";
-            return std::nullopt; // No reachable blocks found
-        }
-
-        // Identify unreachable blocks
-        for (const auto *Block : *cfg) {
-            if (!Block) continue;
-            if (!reachable.count(Block->getBlockID())) {
-                unreachableBlocks.push_back(Block);
-            }
-        }
-
-        // Report each unreachable block in reverse order
-        for(auto Block : llvm::reverse(unreachableBlocks)) {
-            const clang::Stmt *S = getUnreachableStmt(Block);
-            if (S) {
-                reportUnreachableCode(S, sm);
-            } else {
-                llvm::outs() << "Unreachable block without statement\n";
+        // Reused by every function this thread analyzes
+        static thread_local myproject::BlockReachability reachability;
+        reachability.compute(*cfg);
+
+        // One report per region of connected unreachable blocks, at its first statement in source order
+        bool expired = false;
+        reachability.forEachUnreachableRegion([&](llvm::ArrayRef<const clang::CFGBlock*> region) {
+            if (expired || (expired = context.deadline.expired())) return;
+            for (const clang::CFGBlock *Block : region) {
+                if (const clang::Stmt *S = getUnreachableStmt(Block, AC->getParentMap())) {
+                    reportUnreachableCode(S, context.findings, FD);
+                    return;
+                }
             }
-        }
-        visited.clear();
-        reachable.clear();
-        unreachableBlocks.clear();
+            MYPROJECT_LOG(myproject::LogLevel::Debug, "Unreachable region without statement");
+        });
+        if (expired) return false;
     }
     return {};
 }
 
 // Helper function to report unreachable code
-std::optional<bool> UnreachableCodeCheck::reportUnreachableCode(const clang::Stmt* stmt, const clang::SourceManager& sm) {
+// The "file:line" of the message is filled in when the finding is emitted
+std::optional<bool> UnreachableCodeCheck::reportUnreachableCode(const clang::Stmt* stmt, myproject::FindingSink& findings,
+                                                                 const clang::FunctionDecl* FD) {
     if (!stmt) return std::nullopt;
 
     clang::SourceLocation loc = stmt->getBeginLoc();
-    clang::DiagnosticsEngine &Diag = sm.getDiagnostics();
-    unsigned DiagID = Diag.getCustomDiagID(clang::DiagnosticsEngine::Warning,
-                                           "Unreachable code found at '%0'");
-    Diag.Report(loc, DiagID) << sm.getFilename(loc).str() + ":" + std::to_string(sm.getSpellingLineNumber(loc));
+    findings.report({getName(), loc, "Unreachable code found at '{related-file}:{related-line}'", FD->getQualifiedNameAsString(), loc});
     return true;
 }
 
 // Find the Stmt* in a CFGBlock for reporting a warning
-const clang::Stmt* UnreachableCodeCheck::getUnreachableStmt(const clang::CFGBlock *Block) {
+const clang::Stmt* UnreachableCodeCheck::getUnreachableStmt(const clang::CFGBlock *Block, const clang::ParentMap &PM) {
   for (const clang::CFGElement& Elem : *Block) {
     if (std::optional<clang::CFGStmt> S = Elem.getAs<clang::CFGStmt>()) {
-      if (!llvm::isa<clang::DeclStmt>(S->getStmt()))
-        return S->getStmt();
+      if (llvm::isa<clang::DeclStmt>(S->getStmt()))
+        continue;
+      // The shared CFG lists every subexpression (setAllAlwaysAdd), so climb up to the
+      // full expression to report the same statement a default CFG would give us
+      const clang::Stmt *Stmt = S->getStmt();
+      while (const clang::Stmt *Parent = PM.getParent(Stmt)) {
+        if (!llvm::isa<clang::Expr>(Parent))
+          break;
+        Stmt = Parent;
+      }
+      return Stmt;
     }
   }
   return Block->getTerminatorStmt();
 }
-
-// Performs BFS from the entry block to mark reachable nodes
-std::optional<bool> UnreachableCodeCheck::markReachableBlocks(const clang::CFG *cfg, CFG_Set &reachable) {
-    if (!cfg) return std::nullopt;  // Return std::nullopt if cfg is null
-
-    std::queue<const clang::CFGBlock*> queue;
-    queue.push(&cfg->getEntry());
-    reachable.insert(cfg->getEntry().getBlockID());
-
-    while (!queue.empty()) {
-        const clang::CFGBlock* Block = queue.front();
-        queue.pop();
-
-        for (const auto &Succ : Block->succs()) {
-            if (Succ && !reachable.count(Succ->getBlockID())) {
-                reachable.insert(Succ->getBlockID());
-                queue.push(Succ);
-            }
-        }
-    }
-
-    if (reachable.empty()) {
-        return std::nullopt; // Return std::nullopt if no reachable blocks were marked
-    }
-
-    return true; // Successfully marked reachable blocks
-}
-
-
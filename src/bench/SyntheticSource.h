@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <format>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Generators for the synthetic C++ inputs used by the benchmarks
+namespace bench {
+
+// A main file plus the headers it includes, all kept in memory
+struct SyntheticTU {
+    std::string mainFile;
+    std::vector<std::pair<std::string, std::string>> headers; // (path, content)
+};
+
+// A function that triggers every check: a dead store, a variable read while it may be uninitialized,
+// an assignment that is invariant in a loop and code after the return. `statements` extra straight-line
+// statements make the body bigger.
+inline std::string generateFunction(const std::string& name, unsigned statements, bool isInline) {
+    std::string out = std::format("{}int {}(int n) {{\n", isInline ? "inline " : "", name);
+    out += "    int acc = 0;\n"
+           "    int unused = n * 2;\n"
+           "    unused = n;\n"
+           "    int maybe;\n"
+           "    if (n > 3) {\n"
+           "        maybe = n;\n"
+           "    }\n"
+           "    acc += maybe;\n"
+           "    for (int i = 0; i < n; ++i) {\n"
+           "        int k;\n"
+           "        k = 42;\n"
+           "        acc += i + k;\n"
+           "    }\n";
+    for (unsigned i = 0; i < statements; ++i) {
+        out += std::format("    acc = acc * {} + n;\n", i % 7 + 1);
+    }
+    out += "    if (acc > n) {\n"
+           "        acc = n;\n"
+           "    }\n"
+           "    return acc;\n"
+           "    acc = 0;\n"
+           "}\n\n";
+    return out;
+}
+
+// A header full of inline functions, the kind of code every TU of a project pulls in
+inline std::string generateHeader(const std::string& prefix, unsigned functions, unsigned statements) {
+    std::string out = "#pragma once\n\n";
+    for (unsigned i = 0; i < functions; ++i) {
+        out += generateFunction(std::format("{}_{}", prefix, i), statements, true);
+    }
+    return out;
+}
+
+// A TU with `functions` functions in the main file that includes one header with `headerFunctions` inline functions
+inline SyntheticTU generateHeaderHeavyTU(unsigned functions, unsigned headerFunctions, unsigned statements) {
+    SyntheticTU tu;
+    tu.headers.emplace_back("/synthetic/big_header.h", generateHeader("header", headerFunctions, statements));
+    tu.mainFile = "#include \"big_header.h\"\n\n";
+    for (unsigned i = 0; i < functions; ++i) {
+        tu.mainFile += generateFunction(std::format("main_{}", i), statements, false);
+    }
+    return tu;
+}
+
+// One big function with `locals` variables and `branches` if/else statements, each of which adds CFG blocks.
+// Every variable stays live until the final return, so the liveness sets are as wide as the function.
+inline std::string generateHugeFunction(const std::string& name, unsigned locals, unsigned branches) {
+    locals = std::max(locals, 1u);
+    std::string out = std::format("int {}(int n) {{\n", name);
+    for (unsigned i = 0; i < locals; ++i) {
+        out += std::format("    int v{} = n + {};\n", i, i);
+    }
+    for (unsigned b = 0; b < branches; ++b) {
+        unsigned target = b % locals, source = (b * 7 + 3) % locals;
+        out += std::format("    if (n > {}) {{\n        v{} = v{} + {};\n    }} else {{\n        v{} = n - {};\n    }}\n",
+                           b, target, source, b, target, b);
+        // A store that is overwritten right away
+        if (b % 16 == 0) out += std::format("    v{} = {};\n    v{} = n;\n", target, b, target);
+    }
+    out += "    return 0";
+    for (unsigned i = 0; i < locals; ++i) {
+        out += std::format(" + v{}", i);
+    }
+    out += ";\n}\n\n";
+    return out;
+}
+
+// `depth` nested for loops. Every level declares a variable, assigns it a constant (a loop invariant)
+// and accumulates into `acc`, so the checks have work at each level of the nest.
+inline std::string generateLoopNest(const std::string& name, unsigned depth) {
+    std::string out = std::format("int {}(int n) {{\n    int acc = 0;\n", name);
+    for (unsigned d = 0; d < depth; ++d) {
+        std::string indent(4 * (d + 1), ' ');
+        out += std::format("{0}for (int i{1} = 0; i{1} < n; ++i{1}) {{\n"
+                           "{0}    int k{1};\n"
+                           "{0}    k{1} = {1};\n"
+                           "{0}    acc += i{1} + k{1};\n", indent, d);
+    }
+    for (unsigned d = depth; d > 0; --d) {
+        out += std::string(4 * d, ' ') + "}\n";
+    }
+    out += "    return acc;\n}\n\n";
+    return out;
+}
+
+// A switch with `cases` cases, every fourth one falls through into the next
+inline std::string generateSwitch(const std::string& name, unsigned cases) {
+    std::string out = std::format("int {}(int n) {{\n    int acc = 0;\n    switch (n) {{\n", name);
+    for (unsigned c = 0; c < cases; ++c) {
+        out += std::format("    case {}:\n        acc += n * {};\n", c, c % 13 + 1);
+        if (c % 4 != 3) out += "        break;\n";
+    }
+    out += "    default:\n        acc = -1;\n    }\n    return acc;\n}\n\n";
+    return out;
+}
+
+// `branches` if/else statements of about three CFG blocks each. After every `deadEvery`-th one the function
+// may return early, leaving an unreachable region of several blocks behind the return.
+inline std::string generateBranchyFunction(const std::string& name, unsigned branches, unsigned deadEvery) {
+    std::string out = std::format("int {}(int n) {{\n    int acc = 0;\n", name);
+    for (unsigned b = 0; b < branches; ++b) {
+        out += std::format("    if (n > {0}) {{\n        acc += {0};\n    }} else {{\n        acc -= n;\n    }}\n", b);
+        if (deadEvery && b % deadEvery == deadEvery - 1) {
+            out += std::format("    if (n == {0}) {{\n        return acc;\n        acc = {0};\n"
+                               "        if (acc > n) {{\n            acc = 0;\n        }} else {{\n            acc = 1;\n        }}\n    }}\n", b);
+        }
+    }
+    out += "    return acc;\n}\n\n";
+    return out;
+}
+
+// A TU with `functions` huge functions, see generateHugeFunction
+inline SyntheticTU generateHugeFunctionTU(unsigned functions, unsigned locals, unsigned branches) {
+    SyntheticTU tu;
+    for (unsigned i = 0; i < functions; ++i) {
+        tu.mainFile += generateHugeFunction(std::format("huge_{}", i), locals, branches);
+    }
+    return tu;
+}
+
+} // namespace bench
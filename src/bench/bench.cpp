@@ -0,0 +1,625 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <limits>
+#include <new>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#include <clang/Basic/Diagnostic.h>
+#include <clang/Frontend/ASTUnit.h>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/SmallSet.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/raw_ostream.h>
+#include "MatchCallback.h"
+#include "CheckRegistry.h"
+#include "FrontendAction.h"
+#include "DeadStoresCheck.h"
+#include "UnreachableCodeCheck.h"
+#include "LoopInvariantCheck.h"
+#include "UninitializedVariableCheck.h"
+#include "BlockReachability.h"
+#include "MemoryUsage.h"
+#include "SyntheticSource.h"
+
+namespace lc = llvm::cl;
+
+static lc::OptionCategory benchCategory("Benchmark options");
+static lc::list<std::string> Scenarios("scenario", lc::desc("Scenarios to run (default: all)"),
+    lc::ZeroOrMore, lc::value_desc("name"), lc::cat(benchCategory));
+static lc::opt<unsigned> Repeat("repeat", lc::desc("Runs per measurement, the fastest one is reported"),
+    lc::init(5), lc::cat(benchCategory));
+static lc::opt<unsigned> Functions("functions", lc::desc("Functions in the main file"),
+    lc::init(50), lc::cat(benchCategory));
+static lc::opt<unsigned> HeaderFunctions("header-functions", lc::desc("Inline functions in the included header"),
+    lc::init(4000), lc::cat(benchCategory));
+static lc::opt<std::string> Source("source", lc::desc("Real source file for the parse scenarios instead of a synthetic TU"),
+    lc::value_desc("file"), lc::cat(benchCategory));
+static lc::list<std::string> ExtraArgs("extra-arg", lc::desc("Compiler argument used with --source"),
+    lc::ZeroOrMore, lc::cat(benchCategory));
+static lc::opt<unsigned> Statements("statements", lc::desc("Extra straight-line statements per function"),
+    lc::init(10), lc::cat(benchCategory));
+static lc::opt<unsigned> StraightLine("straight-line", lc::desc("Statements of the straight-line function"),
+    lc::init(20000), lc::cat(benchCategory));
+static lc::opt<unsigned> LoopDepth("loop-depth", lc::desc("Depth of the loop nest"),
+    lc::init(48), lc::cat(benchCategory));
+static lc::opt<unsigned> SwitchCases("switch-cases", lc::desc("Cases of the wide switch"),
+    lc::init(2000), lc::cat(benchCategory));
+static lc::opt<unsigned> HugeFunctions("huge-functions", lc::desc("Functions in the huge-function scenarios"),
+    lc::init(2), lc::cat(benchCategory));
+static lc::opt<unsigned> Locals("locals", lc::desc("Local variables per huge function and of the locals shape"),
+    lc::init(1000), lc::cat(benchCategory));
+static lc::opt<unsigned> TUs("tus", lc::desc("TUs including the same header in the header-dedup scenario"),
+    lc::init(8), lc::cat(benchCategory));
+static lc::list<unsigned> ReachabilityBlocks("reachability-blocks",
+    lc::desc("Approximate CFG sizes of the reachability scenario (default: 10000, 30000, 100000)"),
+    lc::ZeroOrMore, lc::CommaSeparated, lc::cat(benchCategory));
+static lc::opt<unsigned> Branches("branches", lc::desc("if/else statements per huge function"),
+    lc::init(2000), lc::cat(benchCategory));
+
+// Heap allocations through operator new, for the allocations scenario
+static std::atomic<uint64_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+// Every registered check
+const std::vector<std::string> allChecks = myproject::CheckRegistry::names();
+
+// Same setup as the tool: the checks are built once and their matchers use TK_IgnoreUnlessSpelledInSource
+std::unique_ptr<myproject::MyMatchCallback> makeCallback(const std::vector<std::string>& checks, bool mainFileOnly,
+                                                         bool fused = false) {
+    auto callback = std::make_unique<myproject::MyMatchCallback>();
+    if (mainFileOnly) callback->restrictTraversalScope({});
+    callback->setFusedWalker(fused);
+    for (const auto& check : checks) {
+        callback->AddCheck(myproject::CheckRegistry::create(check), clang::TK_IgnoreUnlessSpelledInSource);
+    }
+    return callback;
+}
+
+std::unique_ptr<myproject::MyMatchCallback> makeDeadStoresCallback(LivenessEngine engine) {
+    auto callback = std::make_unique<myproject::MyMatchCallback>();
+    callback->AddCheck(std::make_unique<DeadStoresCheck>("dead-stores", engine), clang::TK_IgnoreUnlessSpelledInSource);
+    return callback;
+}
+
+std::unique_ptr<clang::ASTUnit> buildAST(const bench::SyntheticTU& tu) {
+    // The findings themselves are not interesting here, only the time it takes to produce them
+    static clang::IgnoringDiagConsumer ignore;
+    return clang::tooling::buildASTFromCodeWithArgs(
+        tu.mainFile, {"-std=c++17", "-w"}, "/synthetic/main.cpp", "bench",
+        std::make_shared<clang::PCHContainerOperations>(),
+        clang::tooling::getClangStripDependencyFileAdjuster(), tu.headers, &ignore);
+}
+
+// Counts the warnings reported for the main file, used to compare findings across modes
+class CountingDiagConsumer : public clang::DiagnosticConsumer {
+public:
+    void HandleDiagnostic(clang::DiagnosticsEngine::Level level, const clang::Diagnostic& info) override {
+        if (level == clang::DiagnosticsEngine::Warning && info.hasSourceManager() &&
+            info.getSourceManager().isInMainFile(info.getLocation()))
+            ++mainFileWarnings;
+    }
+    unsigned mainFileWarnings = 0;
+};
+
+// Run the tool's own FrontendAction on --source, or on the synthetic TU when no source is given.
+// Returns the number of warnings reported for the main file.
+unsigned runTool(const bench::SyntheticTU& tu, myproject::MyMatchCallback& callback, bool skipHeaderBodies) {
+    std::vector<std::string> args = {"-std=c++17"};
+    args.insert(args.end(), ExtraArgs.begin(), ExtraArgs.end());
+    clang::tooling::FixedCompilationDatabase db(".", args);
+
+    std::string path = Source.empty() ? "/synthetic/main.cpp" : std::string(Source);
+    clang::tooling::ClangTool tool(db, {path});
+    if (Source.empty()) {
+        tool.mapVirtualFile(path, tu.mainFile);
+        for (const auto& [header, content] : tu.headers) tool.mapVirtualFile(header, content);
+    }
+
+    CountingDiagConsumer diags;
+    tool.setDiagnosticConsumer(&diags);
+    myproject::MyFrontendActionFactory factory(&callback, skipHeaderBodies);
+    tool.run(&factory);
+    return diags.mainFileWarnings;
+}
+
+// Run `f` Repeat times and return the fastest wall time in milliseconds
+template <typename F>
+double bestOf(F&& f) {
+    double best = std::numeric_limits<double>::max();
+    for (unsigned i = 0; i < std::max(1u, unsigned(Repeat)); ++i) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+void report(llvm::raw_ostream& os, const std::string& label, double ms, double baseline = 0) {
+    os << std::format("  {:<36}{:>12.2f} ms", label, ms);
+    if (baseline > 0 && ms > 0) os << std::format("   ({:.1f}x)", baseline / ms);
+    os << "\n";
+}
+
+// Matching over the whole TU against matching only the main-file declarations (--main-file-only)
+void runTraversalScope(llvm::raw_ostream& os) {
+    os << std::format("traversal-scope: {} main-file functions, {} header functions\n", unsigned(Functions), unsigned(HeaderFunctions));
+    bench::SyntheticTU tu = bench::generateHeaderHeavyTU(Functions, HeaderFunctions, Statements);
+
+    std::unique_ptr<clang::ASTUnit> ast;
+    report(os, "parse", bestOf([&] { ast = buildAST(tu); }));
+    if (!ast) {
+        os << "  failed to build the AST\n";
+        return;
+    }
+
+    auto whole = makeCallback(allChecks, false);
+    auto mainOnly = makeCallback(allChecks, true);
+    double wholeMs = bestOf([&] { whole->matchAST(ast->getASTContext()); });
+    report(os, "match whole TU", wholeMs);
+    report(os, "match main file only", bestOf([&] { mainOnly->matchAST(ast->getASTContext()); }), wholeMs);
+}
+
+// Parse time with and without --skip-header-bodies. A callback without checks measures the frontend
+// alone; running all checks in both modes shows that the findings do not change.
+void runSkipHeaderBodies(llvm::raw_ostream& os) {
+    if (Source.empty())
+        os << std::format("skip-header-bodies: {} main-file functions, {} header functions\n", unsigned(Functions), unsigned(HeaderFunctions));
+    else
+        os << std::format("skip-header-bodies: {}\n", std::string(Source));
+    bench::SyntheticTU tu = bench::generateHeaderHeavyTU(Functions, HeaderFunctions, Statements);
+
+    auto parseOnly = makeCallback({}, false);
+    double fullMs = bestOf([&] { runTool(tu, *parseOnly, false); });
+    report(os, "parse all bodies", fullMs);
+    report(os, "parse main-file bodies only", bestOf([&] { runTool(tu, *parseOnly, true); }), fullMs);
+
+    auto checks = makeCallback(allChecks, false);
+    unsigned fullWarnings = runTool(tu, *checks, false);
+    unsigned skippedWarnings = runTool(tu, *checks, true);
+    os << std::format("  warnings: {} with all bodies, {} with header bodies skipped{}\n", fullWarnings, skippedWarnings,
+                      fullWarnings == skippedWarnings ? "" : "   (MISMATCH)");
+}
+
+// One input shape of the per-check scenario
+struct Shape {
+    std::string name;
+    bench::SyntheticTU tu;
+};
+
+std::vector<Shape> generateShapes() {
+    std::vector<Shape> shapes;
+    shapes.push_back({std::format("many-functions ({} functions)", unsigned(Functions)),
+                      bench::generateHeaderHeavyTU(Functions, 0, Statements)});
+    shapes.push_back({std::format("straight-line ({} statements)", unsigned(StraightLine)),
+                      {bench::generateFunction("straight_line", StraightLine, false), {}}});
+    shapes.push_back({std::format("loop-nest (depth {})", unsigned(LoopDepth)),
+                      {bench::generateLoopNest("loop_nest", LoopDepth), {}}});
+    shapes.push_back({std::format("switch ({} cases)", unsigned(SwitchCases)),
+                      {bench::generateSwitch("wide_switch", SwitchCases), {}}});
+    shapes.push_back({std::format("locals ({} locals)", unsigned(Locals)),
+                      {bench::generateHugeFunction("many_locals", Locals, 16), {}}});
+    return shapes;
+}
+
+// Peak resident set size of the process in MiB, 0 where getrusage() is not available
+double peakRSSMiB() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(__APPLE__)
+        return usage.ru_maxrss / (1024.0 * 1024.0); // Bytes
+#else
+        return usage.ru_maxrss / 1024.0;            // KiB
+#endif
+    }
+#endif
+    return 0;
+}
+
+// Result of a run made by inChild()
+template <typename T>
+struct ChildRun {
+    T value{};
+    double peakGrowthMiB = -1; // Peak RSS of the run over its RSS at the start, -1 if it could not be measured
+};
+
+// Run `f` in a forked copy of the bench and measure how far it raises the peak RSS. Every run starts from
+// the same memory (the parent's), and what it allocates is gone afterwards, so runs measured one after the
+// other can be compared. The peak is VmHWM after resetPeakRSS(); without that f runs here, unmeasured.
+// T is copied back through a pipe and must be trivially copyable.
+template <typename T, typename F>
+ChildRun<T> inChild(F&& f) {
+    ChildRun<T> run;
+#if defined(__unix__)
+    int fds[2];
+    if (pipe(fds) == 0) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            ChildRun<T> child;
+            if (myproject::resetPeakRSS()) {
+                uint64_t start = myproject::currentRSS();
+                child.value = f();
+                child.peakGrowthMiB = (myproject::peakRSS() - std::min(start, myproject::peakRSS())) / (1024.0 * 1024.0);
+            }
+            ssize_t written = write(fds[1], &child, sizeof(child));
+            _exit(written == ssize_t(sizeof(child)) ? 0 : 1);
+        }
+        close(fds[1]);
+        bool received = pid > 0 && read(fds[0], &run, sizeof(run)) == ssize_t(sizeof(run));
+        close(fds[0]);
+        if (pid > 0) waitpid(pid, nullptr, 0);
+        if (received && run.peakGrowthMiB >= 0) return run;
+    }
+#endif
+    run.value = f();
+    run.peakGrowthMiB = -1;
+    return run;
+}
+
+// "12.3 MiB", or "n/a" when the run could not be measured
+std::string formatGrowth(double mib) {
+    return mib < 0 ? std::string("n/a") : std::format("{:.1f} MiB", mib);
+}
+
+// Functions with a body in the main file and the number of CFG blocks they have together
+std::pair<unsigned, unsigned> countFunctions(clang::ASTContext& context) {
+    const clang::SourceManager& sm = context.getSourceManager();
+    unsigned functions = 0, blocks = 0;
+    for (const clang::Decl* decl : context.getTranslationUnitDecl()->decls()) {
+        const auto* FD = llvm::dyn_cast<clang::FunctionDecl>(decl);
+        if (!FD || !FD->hasBody() || !sm.isInMainFile(FD->getLocation())) continue;
+        ++functions;
+        if (auto AC = myproject::AnalysisCache::buildContext(FD); AC && AC->getCFG()) blocks += AC->getCFG()->getNumBlockIDs();
+    }
+    return {functions, blocks};
+}
+
+// Every check alone and all of them together on each input shape, as throughput, plus the peak RSS growth of
+// all checks on the shape measured in a child of its own
+void runPerCheck(llvm::raw_ostream& os) {
+    os << "per-check:\n";
+    for (const Shape& shape : generateShapes()) {
+        std::unique_ptr<clang::ASTUnit> ast = buildAST(shape.tu);
+        if (!ast) {
+            os << "  " << shape.name << ": failed to build the AST\n";
+            continue;
+        }
+        auto [functions, blocks] = countFunctions(ast->getASTContext());
+        os << std::format(" {}: {} functions, {} CFG blocks\n", shape.name, functions, blocks);
+
+        auto measure = [&](const std::string& label, const std::vector<std::string>& checks) {
+            auto callback = makeCallback(checks, true);
+            double ms = bestOf([&] { callback->matchAST(ast->getASTContext()); });
+            double seconds = std::max(ms, 1e-6) / 1000;
+            os << std::format("  {:<24}{:>10.2f} ms{:>14.0f} functions/s{:>14.0f} blocks/s\n",
+                              label, ms, functions / seconds, blocks / seconds);
+        };
+        for (const auto& check : allChecks) measure(check, {check});
+        measure("all checks", allChecks);
+
+        // Of the shape alone: one run of all checks in a child, on the AST built above
+        auto callback = makeCallback(allChecks, true);
+        ChildRun<bool> run = inChild<bool>([&] {
+            callback->matchAST(ast->getASTContext());
+            return true;
+        });
+        os << std::format("  {:<24}{:>14}\n", "peak RSS growth", formatGrowth(run.peakGrowthMiB));
+    }
+}
+
+// dead-stores with clang::LiveVariables against the dense bitvector solver, on functions with thousands of
+// blocks and variables. Both runs include building the CFG; the reported warnings must be identical.
+void runLiveness(llvm::raw_ostream& os) {
+    os << std::format("liveness: {} functions, {} locals, {} branches each\n", unsigned(HugeFunctions), unsigned(Locals), unsigned(Branches));
+    bench::SyntheticTU tu = bench::generateHugeFunctionTU(HugeFunctions, Locals, Branches);
+
+    std::unique_ptr<clang::ASTUnit> ast = buildAST(tu);
+    if (!ast) {
+        os << "  failed to build the AST\n";
+        return;
+    }
+
+    auto clangEngine = makeDeadStoresCallback(LivenessEngine::Clang);
+    auto bitVector = makeDeadStoresCallback(LivenessEngine::BitVector);
+    double clangMs = bestOf([&] { clangEngine->matchAST(ast->getASTContext()); });
+    report(os, "clang::LiveVariables", clangMs);
+    report(os, "BitVectorLiveness", bestOf([&] { bitVector->matchAST(ast->getASTContext()); }), clangMs);
+
+    unsigned clangWarnings = runTool(tu, *clangEngine, false);
+    unsigned bitVectorWarnings = runTool(tu, *bitVector, false);
+    os << std::format("  warnings: {} with clang::LiveVariables, {} with BitVectorLiveness{}\n", clangWarnings, bitVectorWarnings,
+                      clangWarnings == bitVectorWarnings ? "" : "   (MISMATCH)");
+}
+
+// Several TUs that include the same header, analyzed by one callback like a --jobs=1 run of the tool. With
+// a shared AnalyzedFunctions the inline header functions are analyzed by the first TU only.
+void runHeaderDedup(llvm::raw_ostream& os) {
+    os << std::format("header-dedup: {} TUs, {} main-file functions, {} header functions\n", unsigned(TUs),
+                      unsigned(Functions), unsigned(HeaderFunctions));
+    bench::SyntheticTU tu = bench::generateHeaderHeavyTU(Functions, HeaderFunctions, Statements);
+
+    std::vector<std::unique_ptr<clang::ASTUnit>> asts;
+    for (unsigned i = 0; i < std::max(1u, unsigned(TUs)); ++i) {
+        asts.push_back(buildAST(tu));
+        if (!asts.back()) {
+            os << "  failed to build the AST\n";
+            return;
+        }
+    }
+
+    auto callback = makeCallback(allChecks, false);
+    double everyMs = bestOf([&] {
+        for (auto& ast : asts) callback->matchAST(ast->getASTContext());
+    });
+    report(os, "every TU analyzes the header", everyMs);
+
+    uint64_t skipped = 0;
+    double onceMs = bestOf([&] {
+        myproject::AnalyzedFunctions analyzed; // Fresh for every run, like one invocation of the tool
+        callback->setAnalyzedFunctions(&analyzed);
+        for (auto& ast : asts) callback->matchAST(ast->getASTContext());
+        callback->setAnalyzedFunctions(nullptr);
+        skipped = analyzed.getSkipped();
+    });
+    report(os, "header analyzed once", onceMs, everyMs);
+    os << std::format("  skipped header functions: {}\n", skipped);
+}
+
+// A patch that touches one main-file function against analyzing the whole TU (--changed-lines)
+void runChangedLines(llvm::raw_ostream& os) {
+    os << std::format("changed-lines: {} main-file functions, {} header functions, one function changed\n",
+                      unsigned(Functions), unsigned(HeaderFunctions));
+    bench::SyntheticTU tu = bench::generateHeaderHeavyTU(Functions, HeaderFunctions, Statements);
+    std::unique_ptr<clang::ASTUnit> ast = buildAST(tu);
+    if (!ast) {
+        os << "  failed to build the AST\n";
+        return;
+    }
+
+    // Line 3 is the first line of the first main-file function
+    std::optional<myproject::ChangedLines> changed = myproject::ChangedLines::parse(R"({"main.cpp": [[3, 3]]})");
+    auto whole = makeCallback(allChecks, false);
+    auto patch = makeCallback(allChecks, false);
+    patch->setChangedLines(&*changed);
+    double wholeMs = bestOf([&] { whole->matchAST(ast->getASTContext()); });
+    report(os, "match whole TU", wholeMs);
+    report(os, "match changed function only", bestOf([&] { patch->matchAST(ast->getASTContext()); }), wholeMs);
+}
+
+// The huge functions of the liveness scenario under --max-cfg-blocks and --max-function-seconds. The CFG limit
+// is the number of branches, below the block count of every function, so each one is skipped right after its CFG is built.
+void runBudget(llvm::raw_ostream& os) {
+    os << std::format("budget: {} functions, {} locals, {} branches each\n", unsigned(HugeFunctions), unsigned(Locals), unsigned(Branches));
+    bench::SyntheticTU tu = bench::generateHugeFunctionTU(HugeFunctions, Locals, Branches);
+    std::unique_ptr<clang::ASTUnit> ast = buildAST(tu);
+    if (!ast) {
+        os << "  failed to build the AST\n";
+        return;
+    }
+
+    auto callback = makeCallback(allChecks, false);
+    double unlimitedMs = bestOf([&] { callback->matchAST(ast->getASTContext()); });
+    report(os, "no budget", unlimitedMs);
+
+    auto limited = [&](const char* name, myproject::BudgetLimits limits) {
+        size_t skipped = 0;
+        report(os, name, bestOf([&] {
+            myproject::FunctionBudget budget(limits);
+            callback->setBudget(&budget);
+            callback->matchAST(ast->getASTContext());
+            callback->setBudget(nullptr);
+            skipped = budget.getSkippedCount();
+        }), unlimitedMs);
+        os << std::format("  skipped functions: {}\n", skipped);
+    };
+    limited("max-cfg-blocks", {std::max(1u, unsigned(Branches)), 0, 0});
+    limited("max-function-seconds 1ms", {0, 0, 0.001});
+}
+
+// All checks through their matchers against one FusedWalker pass (--fused-walker), on the header-heavy TU
+// where most of the traversal is spent outside the functions the checks analyze. Both must report the same.
+void runFusedWalker(llvm::raw_ostream& os) {
+    os << std::format("fused-walker: {} main-file functions, {} header functions\n", unsigned(Functions), unsigned(HeaderFunctions));
+    bench::SyntheticTU tu = bench::generateHeaderHeavyTU(Functions, HeaderFunctions, Statements);
+    std::unique_ptr<clang::ASTUnit> ast = buildAST(tu);
+    if (!ast) {
+        os << "  failed to build the AST\n";
+        return;
+    }
+
+    auto matchers = makeCallback(allChecks, false);
+    auto fused = makeCallback(allChecks, false, true);
+    double matchersMs = bestOf([&] { matchers->matchAST(ast->getASTContext()); });
+    report(os, "MatchFinder", matchersMs);
+    report(os, "fused walker", bestOf([&] { fused->matchAST(ast->getASTContext()); }), matchersMs);
+
+    unsigned matcherWarnings = runTool(tu, *matchers, false);
+    unsigned fusedWarnings = runTool(tu, *fused, false);
+    os << std::format("  warnings: {} with MatchFinder, {} with the fused walker{}\n", matcherWarnings, fusedWarnings,
+                      matcherWarnings == fusedWarnings ? "" : "   (MISMATCH)");
+}
+
+// Reachability as UnreachableCodeCheck did it before BlockReachability: a SmallSet of block IDs, a std::queue
+// and one report per unreachable block. Returns the number of reports.
+unsigned legacyUnreachableBlocks(const clang::CFG& cfg) {
+    llvm::SmallSet<unsigned, 32> reachable;
+    std::queue<const clang::CFGBlock*> queue;
+    queue.push(&cfg.getEntry());
+    reachable.insert(cfg.getEntry().getBlockID());
+    while (!queue.empty()) {
+        const clang::CFGBlock* block = queue.front();
+        queue.pop();
+        for (const clang::CFGBlock* succ : block->succs()) {
+            if (succ && !reachable.count(succ->getBlockID())) {
+                reachable.insert(succ->getBlockID());
+                queue.push(succ);
+            }
+        }
+    }
+    unsigned reports = 0;
+    for (const clang::CFGBlock* block : cfg) {
+        if (!reachable.count(block->getBlockID())) ++reports;
+    }
+    return reports;
+}
+
+// Reachability and unreachable regions of single functions with 10^4 to 10^5 CFG blocks, the CFG is built
+// once up front. The engine is reused across the runs like it is across the functions of a thread.
+void runReachability(llvm::raw_ostream& os) {
+    std::vector<unsigned> sizes(ReachabilityBlocks.begin(), ReachabilityBlocks.end());
+    if (sizes.empty()) sizes = {10000, 30000, 100000};
+    os << "reachability: one function per size, an unreachable region every 16 branches\n";
+
+    myproject::BlockReachability engine;
+    for (unsigned size : sizes) {
+        bench::SyntheticTU tu;
+        tu.mainFile = bench::generateBranchyFunction("branchy", std::max(1u, size / 3), 16);
+        std::unique_ptr<clang::ASTUnit> ast = buildAST(tu);
+        const clang::FunctionDecl* FD = nullptr;
+        if (ast) {
+            for (const clang::Decl* D : ast->getASTContext().getTranslationUnitDecl()->decls()) {
+                if (const auto* function = llvm::dyn_cast<clang::FunctionDecl>(D)) FD = function;
+            }
+        }
+        std::shared_ptr<clang::AnalysisDeclContext> context = myproject::AnalysisCache::buildContext(FD);
+        const clang::CFG* cfg = context ? context->getCFG() : nullptr;
+        if (!cfg) {
+            os << "  failed to build the CFG\n";
+            return;
+        }
+
+        os << std::format("  {} blocks\n", cfg->getNumBlockIDs());
+        unsigned legacyReports = 0, regions = 0;
+        double legacyMs = bestOf([&] { legacyReports = legacyUnreachableBlocks(*cfg); });
+        report(os, "SmallSet + std::queue", legacyMs);
+        report(os, "BlockReachability + regions", bestOf([&] {
+            regions = 0;
+            engine.compute(*cfg);
+            engine.forEachUnreachableRegion([&](llvm::ArrayRef<const clang::CFGBlock*>) { ++regions; });
+        }), legacyMs);
+        os << std::format("  reports: {} unreachable blocks, {} regions\n", legacyReports, regions);
+    }
+}
+
+// All checks with and without the check arena (--check-arena), on the huge functions of the liveness scenario and
+// a deep loop nest. Allocations and the peak RSS growth are measured for one matchAST, which includes the CFGs
+// both runs build.
+void runAllocations(llvm::raw_ostream& os) {
+    os << "allocations: all checks, with and without the check arena\n";
+    std::vector<Shape> shapes;
+    shapes.push_back({std::format("huge functions ({} x {} locals, {} branches)", unsigned(HugeFunctions), unsigned(Locals),
+                                  unsigned(Branches)),
+                      bench::generateHugeFunctionTU(HugeFunctions, Locals, Branches)});
+    shapes.push_back({std::format("loop-nest (depth {})", unsigned(LoopDepth)), {bench::generateLoopNest("loop_nest", LoopDepth), {}}});
+
+    for (const Shape& shape : shapes) {
+        std::unique_ptr<clang::ASTUnit> ast = buildAST(shape.tu);
+        if (!ast) {
+            os << "  " << shape.name << ": failed to build the AST\n";
+            continue;
+        }
+        os << " " << shape.name << "\n";
+
+        // The allocations and the peak RSS come from a first matchAST in a child of its own
+        auto measure = [&](const char* name, bool arena, double baselineMs) {
+            auto callback = makeCallback(allChecks, true);
+            callback->setCheckArena(arena);
+            ChildRun<uint64_t> first = inChild<uint64_t>([&] {
+                uint64_t before = allocations.load(std::memory_order_relaxed);
+                callback->matchAST(ast->getASTContext());
+                return allocations.load(std::memory_order_relaxed) - before;
+            });
+            double ms = bestOf([&] { callback->matchAST(ast->getASTContext()); });
+            report(os, name, ms, baselineMs);
+            os << std::format("  {:<36}{:>12}\n", "heap allocations", first.value);
+            os << std::format("  {:<36}{:>16}\n", "peak RSS growth", formatGrowth(first.peakGrowthMiB));
+            return ms;
+        };
+        double heapMs = measure("heap", false, 0);
+        measure("check arena", true, heapMs);
+    }
+}
+
+// What the tool reports per TU with --verbosity=info: the memory of the AST and the sources, and the peak RSS
+// while the TU ran. The RSS after the TU shows how much of it was given back once the TU was freed.
+void runTUMemory(llvm::raw_ostream& os) {
+    os << "tu-memory: all checks through the FrontendAction, one TU at a time\n";
+    std::vector<Shape> shapes;
+    shapes.push_back({Source.empty() ? std::format("header-heavy ({} header functions)", unsigned(HeaderFunctions)) : std::string(Source),
+                      bench::generateHeaderHeavyTU(Functions, HeaderFunctions, Statements)});
+    shapes.push_back({std::format("huge functions ({} x {} locals, {} branches)", unsigned(HugeFunctions), unsigned(Locals),
+                                  unsigned(Branches)),
+                      bench::generateHugeFunctionTU(HugeFunctions, Locals, Branches)});
+
+    auto callback = makeCallback(allChecks, false);
+    callback->setMemoryReport(nullptr, true);
+    for (const Shape& shape : shapes) {
+        double before = myproject::currentRSS() / (1024.0 * 1024.0);
+        runTool(shape.tu, *callback, false);
+        const myproject::TUMemory& memory = callback->getLastTUMemory();
+        os << " " << shape.name << "\n";
+        os << std::format("  {:<36}{:>12.1f} MiB\n", "AST and sources", memory.tuBytes / (1024.0 * 1024.0));
+        os << std::format("  {:<36}{:>12.1f} MiB\n", "peak RSS of the TU", memory.peakRSS / (1024.0 * 1024.0));
+        os << std::format("  {:<36}{:>12.1f} MiB\n", "RSS before the TU", before);
+        os << std::format("  {:<36}{:>12.1f} MiB\n", "RSS after the TU", myproject::currentRSS() / (1024.0 * 1024.0));
+    }
+}
+
+struct Scenario {
+    const char* name;
+    void (*run)(llvm::raw_ostream&);
+};
+
+const Scenario scenarios[] = {
+    {"traversal-scope", runTraversalScope},
+    {"skip-header-bodies", runSkipHeaderBodies},
+    {"per-check", runPerCheck},
+    {"liveness", runLiveness},
+    {"header-dedup", runHeaderDedup},
+    {"changed-lines", runChangedLines},
+    {"budget", runBudget},
+    {"fused-walker", runFusedWalker},
+    {"reachability", runReachability},
+    {"allocations", runAllocations},
+    {"tu-memory", runTUMemory},
+};
+
+} // namespace
+
+int main(int argc, const char** argv) {
+    lc::HideUnrelatedOptions(benchCategory);
+    lc::ParseCommandLineOptions(argc, argv, "Benchmarks for the analysis checks on synthetic inputs\n");
+
+    // Only the results, no trace output of the checks
+    myproject::Log::setLevel(myproject::LogLevel::Quiet);
+    llvm::raw_ostream& os = llvm::outs();
+    for (const Scenario& scenario : scenarios) {
+        if (!Scenarios.empty() && std::find(Scenarios.begin(), Scenarios.end(), scenario.name) == Scenarios.end())
+            continue;
+        scenario.run(os);
+    }
+    os << std::format("peak RSS: {:.1f} MiB\n", peakRSSMiB());
+    return 0;
+}
@@ -2,18 +2,35 @@
 #include <string>
 #include <clang/ASTMatchers/ASTMatchers.h>
 #include <clang/ASTMatchers/ASTMatchFinder.h>
-#include <clang/ASTMatchers/Dynamic/VariantValue.h>
 #include <clang/AST/Type.h>
 #include <clang/Frontend/FrontendActions.h>
 #include <clang/Tooling/CommonOptionsParser.h>
 #include <clang/Tooling/Tooling.h>
 #include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
 #include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/TextDiagnosticPrinter.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/VirtualFileSystem.h>
+#include <algorithm>
+#include <mutex>
+#include <optional>
 #include "MatchCallback.h"
+#include "FrontendAction.h"
+#include "TimeReport.h"
+#include "ResultCache.h"
+#include "ChangedLines.h"
+#include "FunctionBudget.h"
+#include "MemoryUsage.h"
+#include "Log.h"
 #include "CheckStrategies.h"
+#include "CheckRegistry.h"
 #include "DeadStoresCheck.h"
 #include "UnreachableCodeCheck.h"
 #include "LoopInvariantCheck.h"
+#include "UninitializedVariableCheck.h"
 
 namespace ct = clang::tooling;
 namespace cam = clang::ast_matchers;
@@ -27,93 +44,248 @@ static lc::list<std::string> Checks(
 static lc::OptionCategory optionCategory("Tool options");
 static lc::opt<bool> clAsIs("i", lc::desc("Implicit nodes"),
     lc::cat(optionCategory));
-
-std::unique_ptr<CheckStrategy> getStrategy(const std::string& type) {
-    if (type == "dead-stores"){
-        return std::make_unique<DeadStoresCheck>("dead-stores");
-    } else if(type == "unreachable-code") {
-        return std::make_unique<UnreachableCodeCheck>("unreachable-code");
-    } else if(type == "uninitialized-variable") {
-        return nullptr;
-    } else if(type == "loop-invariant") {
-        return std::make_unique<LoopInvariantCheck>("loop-invariant");
-    }else {
-        llvm::errs() << "Unknown matcher type: " << type << "\n";
-        return nullptr;
+static lc::opt<unsigned> Jobs("jobs", lc::desc("Number of translation units analyzed concurrently (0 = all cores)"),
+    lc::init(1), lc::cat(optionCategory));
+static lc::opt<unsigned> FunctionJobs("function-jobs", lc::desc("Number of functions of a TU analyzed concurrently (0 = all cores)"),
+    lc::init(1), lc::cat(optionCategory));
+static lc::opt<bool> MainFileOnly("main-file-only", lc::desc("Only traverse top-level declarations of the main file (and of --scope-file) when matching"),
+    lc::cat(optionCategory));
+static lc::opt<bool> SkipHeaderBodies("skip-header-bodies", lc::desc("Do not parse function bodies outside the main file (and --scope-file)"),
+    lc::cat(optionCategory));
+static lc::list<std::string> ScopeFiles("scope-file", lc::desc("With --main-file-only, also traverse declarations of this file"),
+    lc::ZeroOrMore, lc::value_desc("file"), lc::cat(optionCategory));
+static lc::opt<bool> UseFusedWalker("fused-walker",
+    lc::desc("Find the functions of all checks in one walk of the AST instead of running each check's matchers"),
+    lc::cat(optionCategory));
+static lc::opt<bool> CheckArena("check-arena",
+    lc::desc("Allocate the per-function temporaries of the checks from an arena reset after every check (default on)"),
+    lc::init(true), lc::cat(optionCategory));
+static lc::opt<LivenessEngine> Liveness("liveness", lc::desc("Liveness engine used by dead-stores"),
+    lc::values(clEnumValN(LivenessEngine::BitVector, "bitvector", "Dense bitvector solver (default)"),
+               clEnumValN(LivenessEngine::Clang, "clang", "clang::LiveVariables, cannot stop early for --max-function-seconds")),
+    lc::init(LivenessEngine::BitVector), lc::cat(optionCategory));
+static lc::opt<myproject::LogLevel> Verbosity("verbosity", lc::desc("Amount of progress and debug output on stdout"),
+    lc::values(clEnumValN(myproject::LogLevel::Quiet, "quiet", "Only diagnostics"),
+               clEnumValN(myproject::LogLevel::Info, "info", "Enabled checks and similar setup messages (default)"),
+               clEnumValN(myproject::LogLevel::Debug, "debug", "Unexpected situations inside the checks"),
+               clEnumValN(myproject::LogLevel::Trace, "trace", "Per-function trace of the checks, unless built with MYPROJECT_ENABLE_TRACE=OFF")),
+    lc::init(myproject::LogLevel::Info), lc::cat(optionCategory));
+static lc::opt<bool> DedupHeaderFunctions("dedup-header-functions",
+    lc::desc("Analyze an inline function of a header once per run instead of once per including TU (default on)"),
+    lc::init(true), lc::cat(optionCategory));
+static lc::opt<myproject::OutputFormat> Format("output-format", lc::desc("How the findings are reported"),
+    lc::values(clEnumValN(myproject::OutputFormat::Text, "text", "Clang warnings on stderr (default)"),
+               clEnumValN(myproject::OutputFormat::JSONL, "jsonl", "One JSON object per finding and line"),
+               clEnumValN(myproject::OutputFormat::SARIF, "sarif", "SARIF 2.1.0")),
+    lc::init(myproject::OutputFormat::Text), lc::cat(optionCategory));
+static lc::opt<std::string> OutputFile("output", lc::desc("Where --output-format=jsonl|sarif writes the findings, - for stdout"),
+    lc::value_desc("file"), lc::init("-"), lc::cat(optionCategory));
+static lc::opt<std::string> ChangedLinesFile("changed-lines",
+    lc::desc("Only analyze functions overlapping these lines: a unified diff, or JSON {\"file\": [[first, last], ...]}"),
+    lc::value_desc("file"), lc::cat(optionCategory));
+static lc::opt<std::string> CacheDir("cache-dir",
+    lc::desc("Keep the findings of every TU in this directory and answer unchanged TUs from it without parsing"),
+    lc::value_desc("directory"), lc::cat(optionCategory));
+static lc::opt<unsigned> CacheSize("cache-size", lc::desc("Size limit of --cache-dir in MiB, least recently used TUs go first"),
+    lc::init(1024), lc::cat(optionCategory));
+static lc::opt<bool> UseFunctionMemo("function-memo",
+    lc::desc("With --cache-dir, reuse the findings of functions that did not change inside a changed TU (default on)"),
+    lc::init(true), lc::cat(optionCategory));
+static lc::opt<unsigned> MaxCFGBlocks("max-cfg-blocks", lc::desc("Skip functions whose CFG has more blocks than this (0 = no limit)"),
+    lc::init(0), lc::cat(optionCategory));
+static lc::opt<unsigned> MaxASTNodes("max-ast-nodes", lc::desc("Skip functions whose body has more statements than this (0 = no limit)"),
+    lc::init(0), lc::cat(optionCategory));
+static lc::opt<double> MaxFunctionSeconds("max-function-seconds",
+    lc::desc("Drop the findings of a check on a function when it spends more seconds on it than this (0 = no limit)"),
+    lc::init(0), lc::cat(optionCategory));
+static lc::opt<unsigned> MaxMemory("max-memory",
+    lc::desc("With --jobs, start a TU only when it is expected to fit into this many MiB next to the running ones (0 = no limit)"),
+    lc::init(0), lc::cat(optionCategory));
+static lc::opt<std::string> TimeReportFile("time-report", lc::desc("Write wall times and call counts per TU, phase, check and matcher to this JSON file"),
+    lc::value_desc("file.json"), lc::cat(optionCategory));
+static lc::opt<unsigned> TimeReportFunctions("time-report-functions", lc::desc("Number of slowest functions listed by --time-report"),
+    lc::init(20), lc::cat(optionCategory));
+
+// Shared by every MyMatchCallback when --time-report is given
+static std::unique_ptr<myproject::TimeReport> timeReport;
+// Shared by every MyMatchCallback with a structured --output-format
+static std::unique_ptr<llvm::raw_fd_ostream> findingStream;
+static std::unique_ptr<myproject::FindingWriter> findingWriter;
+// Set by --changed-lines
+static std::optional<myproject::ChangedLines> changedLines;
+// Shared by every MyMatchCallback and worker when --cache-dir is given
+static std::unique_ptr<myproject::ResultCache> resultCache;
+// Set when any of --max-cfg-blocks, --max-ast-nodes and --max-function-seconds is given
+static std::unique_ptr<myproject::FunctionBudget> functionBudget;
+// Memory of every analyzed TU
+static myproject::MemoryReport memoryReport;
+// Header functions analyzed so far, shared by every MyMatchCallback unless --dedup-header-functions=false
+static myproject::AnalyzedFunctions analyzedFunctions;
+
+// Build the configured checks and register their matchers. This is done once per worker and
+// reused for every TU, so building the checks and their matchers is not paid again for each file.
+static std::unique_ptr<myproject::MyMatchCallback> createMatchCallback(bool log) {
+    auto matchCallback = std::make_unique<myproject::MyMatchCallback>(timeReport.get());
+    if (MainFileOnly) matchCallback->restrictTraversalScope({ScopeFiles.begin(), ScopeFiles.end()});
+    matchCallback->setFusedWalker(UseFusedWalker);
+    matchCallback->setFunctionJobs(FunctionJobs);
+    matchCallback->setFindingWriter(findingWriter.get());
+    if (DedupHeaderFunctions) matchCallback->setAnalyzedFunctions(&analyzedFunctions);
+    matchCallback->setResultCache(resultCache.get());
+    if (changedLines) matchCallback->setChangedLines(&*changedLines);
+    matchCallback->setFunctionMemo(UseFunctionMemo);
+    matchCallback->setBudget(functionBudget.get());
+    matchCallback->setCheckArena(CheckArena);
+    matchCallback->setMemoryReport(&memoryReport, Jobs == 1);
+
+    for (const auto &check : Checks) {
+        auto strategy = myproject::CheckRegistry::create(check, {Liveness.getValue()});
+        if (!strategy) continue;
+        // TK_IgnoreUnlessSpelledInSource is used to ignore implicit nodes记得开！
+        if (matchCallback->AddCheck(std::move(strategy), clAsIs ? clang::TK_AsIs : clang::TK_IgnoreUnlessSpelledInSource)) {
+            if (log) MYPROJECT_LOG(myproject::LogLevel::Info, "Added check: {}", check);
+        }
     }
+    return matchCallback;
 }
 
-cam::dynamic::VariantMatcher traverse(clang::TraversalKind kind, cam::dynamic::VariantMatcher matcher) {
-    using namespace cam;
-    if (matcher.hasTypedMatcher<clang::Decl>()){
-        return dynamic::VariantMatcher::SingleMatcher(traverse(kind, matcher.getTypedMatcher<clang::Decl>()));
-    }else if (matcher.hasTypedMatcher<clang::Stmt>()) {
-        return dynamic::VariantMatcher::SingleMatcher(traverse(kind, matcher.getTypedMatcher<clang::Stmt>()));
-    }else{
-        llvm::errs() << "Cannot traverse the matcher. No known method to handle it\n";
-        return cam::dynamic::VariantMatcher(); 
-    }   
-}
+// The sources worth parsing for --changed-lines. A changed source file only matters to its own TU, but
+// any other changed file may be included anywhere, in which case every source is kept.
+static std::vector<std::string> changedSources(const std::vector<std::string>& sources, const myproject::ChangedLines& changed) {
+    static const char* const sourceExtensions[] = {".c", ".cc", ".cpp", ".cxx", ".c++", ".m", ".mm", ".cu"};
+    for (const auto& entry : changed.getFiles()) {
+        llvm::StringRef extension = llvm::sys::path::extension(entry.first());
+        if (std::none_of(std::begin(sourceExtensions), std::end(sourceExtensions),
+                         [&](const char* source) { return extension.equals_insensitive(source); }))
+            return sources;
+    }
 
-class MyASTConsumer : public clang::ASTConsumer {
-public:
-    explicit MyASTConsumer(cam::MatchFinder* Finder) : Finder(Finder) {}
+    std::vector<std::string> result;
+    for (const auto& source : sources) {
+        llvm::Expected<std::string> path = ct::getAbsolutePath(source);
+        if (!path) llvm::consumeError(path.takeError());
+        if (changed.find(source) || (path && changed.find(*path))) result.push_back(source);
+    }
+    return result;
+}
 
-    // After the AST has been parsed completely, the HandleTranslationUnit method is called
-    void HandleTranslationUnit(clang::ASTContext &Context) override { Finder->matchAST(Context);}
+// Every option apart from the checks that changes what the checks report, part of the cache key
+static std::string cacheConfig() {
+    std::string scope;
+    for (const auto& file : ScopeFiles) scope += file + ";";
+    // TUs that hit --max-function-seconds are never stored, the time limit is not part of the key
+    return std::format("liveness={} main-file-only={} scope-files={} as-is={} dedup-header-functions={} "
+                       "max-cfg-blocks={} max-ast-nodes={} fused-walker={} skip-header-bodies={}",
+                       static_cast<int>(Liveness.getValue()), bool(MainFileOnly), scope, bool(clAsIs), bool(DedupHeaderFunctions),
+                       unsigned(MaxCFGBlocks), unsigned(MaxASTNodes), bool(UseFusedWalker), bool(SkipHeaderBodies));
+}
 
-private:
-    cam::MatchFinder* Finder;
-};
+// Report the findings of `file` from the cache if none of its inputs changed. Text output goes to `os`.
+static bool answerFromCache(const ct::CompilationDatabase& compilations, const std::string& file, llvm::raw_ostream& os) {
+    if (!resultCache) return false;
+    llvm::Expected<std::string> path = ct::getAbsolutePath(file);
+    if (!path) {
+        llvm::consumeError(path.takeError());
+        return false;
+    }
+    // A file compiled more than once is analyzed every time, one entry could not tell the commands apart
+    std::vector<ct::CompileCommand> commands = compilations.getCompileCommands(*path);
+    if (commands.size() != 1) return false;
+
+    myproject::AnalyzedFunctions* analyzed = DedupHeaderFunctions ? &analyzedFunctions : nullptr;
+    std::optional<myproject::TUResult> result = resultCache->lookup(commands.front(), analyzed);
+    if (!result) return false;
+    myproject::ResultCache::replay(*result, analyzed, findingWriter.get(), os);
+    return true;
+}
 
-// Custom FrontendAction
-class MyFrontendAction : public clang::ASTFrontendAction {
+// Prebuilt MyMatchCallbacks for the parallel mode. A worker takes one for the duration of a TU and
+// gives it back afterwards, so no more than --jobs check sets are ever built.
+class MatchCallbackPool {
 public:
-    MyFrontendAction() 
-        : matchFinder(std::make_unique<cam::MatchFinder>()) {}
-
-    std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(clang::CompilerInstance &CI, llvm::StringRef file) override {
-        clang::DiagnosticsEngine& diagEngine = CI.getDiagnostics();
-        matchCallback = std::make_unique<myproject::MyMatchCallback>(diagEngine);
-
-        // Check the size of Checks
-        if (Checks.empty()) {
-            unsigned diagID = diagEngine.getCustomDiagID(clang::DiagnosticsEngine::Warning, 
-                                                         "No checks specified. At least one check must be provided.");
-            diagEngine.Report(diagID);
-            return std::make_unique<clang::ASTConsumer>(); // Return an empty ASTConsumer, not sure if this is a best practice
-        }
-
-        for (const auto &check : Checks) {
-            auto strategy = getStrategy(check);
-            if (strategy) {
-                for (const auto& matcher : strategy->getMatchers()) {
-                    if(!matchFinder->addDynamicMatcher( // TK_IgnoreUnlessSpelledInSource is used to ignore implicit nodes记得开！
-                        *traverse(clAsIs ? clang::TK_AsIs : clang::TK_IgnoreUnlessSpelledInSource, matcher).getSingleMatcher(),
-                        matchCallback.get()
-                    )) {
-                        llvm::errs() << "Error adding matcher: " << check << "\n";
-                    }
-                }
-                if(matchCallback->AddCheck(std::move(strategy))) llvm::outs() << "Added check: " << check << "\n";
+    std::unique_ptr<myproject::MyMatchCallback> acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!free.empty()) {
+                auto matchCallback = std::move(free.back());
+                free.pop_back();
+                return matchCallback;
             }
-            
-            // Log the check and this check cannot go wrong the strategy is already checked. So this is only for log check when adding a "new" check
-            //if(matchCallback->AddCheck(check)) llvm::outs() << "Added check: " << check << "\n";
         }
-
-        // Pass the MatchFinder to the ASTConsumer
-        return std::make_unique<MyASTConsumer>(matchFinder.get());
+        return createMatchCallback(false);
     }
 
-    //void EndSourceFileAction() override {}
+    void release(std::unique_ptr<myproject::MyMatchCallback> matchCallback) {
+        std::lock_guard<std::mutex> lock(mutex);
+        free.push_back(std::move(matchCallback));
+    }
 
 private:
-    std::unique_ptr<myproject::MyMatchCallback> matchCallback;  
-    std::unique_ptr<cam::MatchFinder> matchFinder; 
+    std::mutex mutex;
+    std::vector<std::unique_ptr<myproject::MyMatchCallback>> free;
 };
 
 
+// Run every source file on its own ClangTool inside a thread pool. Each worker has its own
+// FrontendAction and borrows a MatchCallback from the pool, and diagnostics are buffered per TU and printed in the order
+// the files were given, so the output does not depend on scheduling.
+static int runParallel(const ct::CompilationDatabase& compilations, const std::vector<std::string>& files,
+                       unsigned jobs, std::unique_ptr<myproject::MyMatchCallback> first) {
+    MatchCallbackPool callbacks;
+    callbacks.release(std::move(first));
+    unsigned threads = llvm::hardware_concurrency(jobs).compute_thread_count();
+    std::optional<myproject::MemoryLimiter> limiter;
+    if (MaxMemory) limiter.emplace(uint64_t(MaxMemory) << 20);
+    std::vector<std::string> outputs(files.size());
+    std::vector<bool> done(files.size(), false);
+    size_t nextToPrint = 0;
+    std::mutex outputMutex;
+    int status = 0;
+
+    llvm::ThreadPool pool(llvm::hardware_concurrency(jobs));
+    for (size_t i = 0; i < files.size(); ++i) {
+        pool.async([&, i] {
+            std::string buffer;
+            llvm::raw_string_ostream os(buffer);
+            int result = 0;
+            if (!answerFromCache(compilations, files[i], os)) {
+                llvm::IntrusiveRefCntPtr<clang::DiagnosticOptions> diagOpts = new clang::DiagnosticOptions();
+                clang::TextDiagnosticPrinter printer(os, diagOpts.get());
+
+                // Each worker gets an independent VFS so concurrent tools do not share a working directory
+                ct::ClangTool tool(compilations, {files[i]}, std::make_shared<clang::PCHContainerOperations>(),
+                                   llvm::vfs::createPhysicalFileSystem());
+                tool.setDiagnosticConsumer(&printer);
+                myproject::MemoryLimiter::Ticket ticket = limiter ? limiter->acquire() : myproject::MemoryLimiter::Ticket();
+                auto matchCallback = callbacks.acquire();
+                myproject::MyFrontendActionFactory factory(matchCallback.get(), SkipHeaderBodies);
+                // The TU's AST is freed when run() returns
+                result = tool.run(&factory);
+                if (limiter) limiter->release(ticket, matchCallback->getLastTUMemory().tuBytes);
+                callbacks.release(std::move(matchCallback));
+            }
+            os.flush();
+
+            // Print every TU whose predecessors are all finished
+            std::lock_guard<std::mutex> lock(outputMutex);
+            outputs[i] = std::move(buffer);
+            done[i] = true;
+            status |= result;
+            while (nextToPrint < files.size() && done[nextToPrint]) {
+                llvm::errs() << outputs[nextToPrint];
+                std::string().swap(outputs[nextToPrint]);
+                ++nextToPrint;
+            }
+        });
+    }
+    pool.wait();
+    if (limiter) {
+        MYPROJECT_LOG(myproject::LogLevel::Info, "Memory: at most {} of {} TUs at once under --max-memory={}, largest TU peak {:.1f} MiB",
+                      limiter->getPeakRunning(), threads, unsigned(MaxMemory), limiter->getLargestPeak() / (1024.0 * 1024.0));
+    }
+    return status;
+}
+
 int main(int argc, const char **argv) {
 	auto optParser = ct::CommonOptionsParser::create(argc, argv, optionCategory);
 
@@ -122,9 +294,93 @@ int main(int argc, const char **argv) {
 		return 1;
 	}
 
-	ct::ClangTool tool(optParser->getCompilations(), optParser->getSourcePathList());
+    // Check the size of Checks
+    if (Checks.empty()) {
+        llvm::errs() << "warning: No checks specified. At least one check must be provided.\n";
+        return 0;
+    }
+
+    myproject::Log::setLevel(Verbosity);
+    if (!TimeReportFile.empty()) timeReport = std::make_unique<myproject::TimeReport>(TimeReportFunctions);
+    if (Format != myproject::OutputFormat::Text) {
+        std::error_code error;
+        findingStream = std::make_unique<llvm::raw_fd_ostream>(OutputFile, error, llvm::sys::fs::OF_Text);
+        if (error) {
+            llvm::errs() << "Cannot write findings to " << OutputFile << ": " << error.message() << "\n";
+            return 1;
+        }
+        // Large writes, a run can produce millions of records
+        findingStream->SetBufferSize(1 << 20);
+        if (OutputFile == "-") myproject::Log::setStream(llvm::errs());
+        findingWriter = std::make_unique<myproject::FindingWriter>(Format, *findingStream,
+                                                                   std::vector<std::string>(Checks.begin(), Checks.end()));
+    }
+    if (!ChangedLinesFile.empty()) {
+        changedLines = myproject::ChangedLines::read(ChangedLinesFile);
+        if (!changedLines) return 1;
+        // The findings of a TU would be incomplete
+        if (!CacheDir.empty()) llvm::errs() << "warning: --cache-dir is ignored with --changed-lines\n";
+        CacheDir.setValue("");
+    }
+    if (MaxCFGBlocks || MaxASTNodes || MaxFunctionSeconds > 0) {
+        functionBudget = std::make_unique<myproject::FunctionBudget>(
+            myproject::BudgetLimits{MaxCFGBlocks, MaxASTNodes, MaxFunctionSeconds});
+    }
+    if (!CacheDir.empty()) {
+        resultCache = std::make_unique<myproject::ResultCache>(CacheDir, uint64_t(CacheSize) << 20, cacheConfig(),
+                                                               std::vector<std::string>(Checks.begin(), Checks.end()));
+    }
+    auto matchCallback = createMatchCallback(true);
+
+    std::vector<std::string> sources = optParser->getSourcePathList();
+    if (changedLines) {
+        size_t all = sources.size();
+        sources = changedSources(sources, *changedLines);
+        MYPROJECT_LOG(myproject::LogLevel::Info, "Changed lines: {} of {} files to analyze", sources.size(), all);
+    }
+
+    int status = 0;
+    if (Jobs != 1) {
+        status = runParallel(optParser->getCompilations(), sources, Jobs, std::move(matchCallback));
+    } else {
+        // Cached TUs are reported first, the rest is analyzed in one go
+        std::vector<std::string> files;
+        for (const auto& file : sources) {
+            if (!answerFromCache(optParser->getCompilations(), file, llvm::errs())) files.push_back(file);
+        }
+        if (!files.empty()) {
+            ct::ClangTool tool(optParser->getCompilations(), files);
+
+            myproject::MyFrontendActionFactory factory(matchCallback.get(), SkipHeaderBodies);
+            status = tool.run(&factory);
+        }
+    }
 
-    int status = tool.run(ct::newFrontendActionFactory<MyFrontendAction>().get());
+    if (analyzedFunctions.getSkipped()) {
+        MYPROJECT_LOG(myproject::LogLevel::Info, "Header functions: {} analyzed, {} already analyzed in another TU",
+                      analyzedFunctions.getClaimed(), analyzedFunctions.getSkipped());
+    }
+    if (functionBudget) functionBudget->printSummary(llvm::errs(), 20);
+    memoryReport.logSummary(10);
+    if (resultCache) {
+        resultCache->prune();
+        MYPROJECT_LOG(myproject::LogLevel::Info, "Result cache: {} TUs answered from {}, {} analyzed",
+                      resultCache->getHits(), std::string(CacheDir), resultCache->getMisses());
+        uint64_t functions = resultCache->getFunctionHits() + resultCache->getFunctionMisses();
+        if (functions) {
+            MYPROJECT_LOG(myproject::LogLevel::Info, "Function memo: {} of {} function analyses reused ({:.1f}%)",
+                          resultCache->getFunctionHits(), functions, 100.0 * resultCache->getFunctionHits() / functions);
+        }
+    }
+    if (findingWriter) {
+        findingWriter->finish();
+        if (findingStream->has_error()) {
+            llvm::errs() << "Cannot write findings to " << OutputFile << ": " << findingStream->error().message() << "\n";
+            findingStream->clear_error();
+            status = 1;
+        }
+    }
+    if (timeReport && !timeReport->write(TimeReportFile)) status = 1;
 	return !status ? 0 : 1;
 }
 
@@ -0,0 +1,120 @@
+// Tests of the --changed-lines parser, run by ctest. Exits with 1 if any expectation fails.
+#include "ChangedLines.h"
+#include <llvm/Support/raw_ostream.h>
+#include <format>
+#include <optional>
+#include <string>
+#include <vector>
+
+using myproject::ChangedLines;
+
+static int failures = 0;
+
+static void expect(bool condition, const std::string& what) {
+    if (condition) return;
+    llvm::errs() << "FAILED: " << what << "\n";
+    ++failures;
+}
+
+// The ranges of `file`, empty if nothing in it changed
+static std::vector<ChangedLines::Range> rangesOf(const ChangedLines& changed, llvm::StringRef file) {
+    const std::vector<ChangedLines::Range>* ranges = changed.find(file);
+    return ranges ? *ranges : std::vector<ChangedLines::Range>();
+}
+
+static void expectRanges(const ChangedLines& changed, llvm::StringRef file, const std::vector<ChangedLines::Range>& expected,
+                         const std::string& what) {
+    std::vector<ChangedLines::Range> actual = rangesOf(changed, file);
+    std::string text;
+    for (const auto& [first, last] : actual) text += std::format("[{}, {}] ", first, last);
+    expect(actual == expected, std::format("{}: {} has {}", what, file.str(), text.empty() ? "no ranges" : text));
+}
+
+static void addedAndDeletedLines() {
+    std::optional<ChangedLines> changed = ChangedLines::parse(
+        "diff --git a/src/a.cpp b/src/a.cpp\n"
+        "--- a/src/a.cpp\n"
+        "+++ b/src/a.cpp\n"
+        "@@ -10,3 +10,4 @@ void f() {\n"
+        " int x = 0;\n"
+        "+int y = 1;\n"
+        " int z = 2;\n"
+        " return;\n"
+        "@@ -40,2 +41,1 @@\n"
+        "-int gone = 0;\n"
+        " int kept = 1;\n");
+    expect(changed.has_value(), "added and deleted lines: parsed");
+    if (changed) expectRanges(*changed, "src/a.cpp", {{11, 11}, {41, 41}}, "added and deleted lines");
+}
+
+// The last lines of a hunk delete "-- x" and add "++ y": they are hunk lines, not the headers of a next file
+static void hunkLinesThatLookLikeHeaders() {
+    std::optional<ChangedLines> changed = ChangedLines::parse(
+        "--- a/src/a.cpp\n"
+        "+++ b/src/a.cpp\n"
+        "@@ -5,3 +5,3 @@\n"
+        " int a;\n"
+        "+++ y;\n"
+        "--- x;\n"
+        " int b;\n"
+        "--- a/src/b.cpp\n"
+        "+++ b/src/b.cpp\n"
+        "@@ -1,2 +1,0 @@\n"
+        "-- removed;\n"
+        "--- removed;\n"
+        "--- a/src/c.cpp\n"
+        "+++ b/src/c.cpp\n"
+        "@@ -7 +7 @@\n"
+        "-old\n"
+        "+new\n");
+    expect(changed.has_value(), "header-like hunk lines: parsed");
+    if (!changed) return;
+    expectRanges(*changed, "src/a.cpp", {{6, 7}}, "header-like hunk lines");
+    expectRanges(*changed, "src/b.cpp", {{1, 1}}, "header-like hunk lines");
+    expectRanges(*changed, "src/c.cpp", {{7, 7}}, "header-like hunk lines");
+    expect(changed->getFiles().size() == 3, "header-like hunk lines: exactly three files");
+}
+
+static void noNewlineMarkerAndDeletedFile() {
+    std::optional<ChangedLines> changed = ChangedLines::parse(
+        "--- a/src/a.cpp\n"
+        "+++ b/src/a.cpp\n"
+        "@@ -3 +3 @@\n"
+        "-}\n"
+        "\\ No newline at end of file\n"
+        "+}\n"
+        "\\ No newline at end of file\n"
+        "--- a/src/gone.cpp\n"
+        "+++ /dev/null\n"
+        "@@ -1,1 +0,0 @@\n"
+        "-int gone;\n");
+    expect(changed.has_value(), "no newline marker: parsed");
+    if (!changed) return;
+    expectRanges(*changed, "src/a.cpp", {{3, 3}}, "no newline marker");
+    expect(changed->getFiles().size() == 1, "deleted file: not listed");
+}
+
+static void countsThatDoNotAddUp() {
+    // The header promises one new line, the second "+" line comes after the hunk and is not part of it
+    std::optional<ChangedLines> changed = ChangedLines::parse(
+        "+++ b/a.cpp\n"
+        "@@ -1,0 +1,1 @@\n"
+        "+one\n"
+        "+two\n");
+    expect(changed.has_value(), "hunk counts: parsed");
+    if (changed) expectRanges(*changed, "a.cpp", {{1, 1}}, "hunk counts");
+
+    expect(!ChangedLines::parse("+++ b/a.cpp\n"
+                                "@@ -1,1 +1,1 @@\n"
+                                "garbage\n").has_value(),
+           "hunk counts: a line of no known kind inside a hunk is an error");
+}
+
+int main() {
+    addedAndDeletedLines();
+    hunkLinesThatLookLikeHeaders();
+    noNewlineMarkerAndDeletedFile();
+    countsThatDoNotAddUp();
+    if (failures) llvm::errs() << failures << " expectation(s) failed\n";
+    return failures ? 1 : 0;
+}